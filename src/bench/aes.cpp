@@ -0,0 +1,61 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <crypto/aes.h>
+
+#include <cassert>
+#include <vector>
+
+/* Number of bytes to process per iteration */
+static const size_t BUFFER_SIZE_LARGE = 1024*1024;
+
+static void AES256CBC_ENCRYPT_1MB(benchmark::Bench& bench)
+{
+    std::vector<unsigned char> key(AES256_KEYSIZE, 0x11), iv(AES_BLOCKSIZE, 0x22);
+    AES256CBCEncrypt enc(key.data(), iv.data(), false);
+    std::vector<unsigned char> in(BUFFER_SIZE_LARGE, 0), out(BUFFER_SIZE_LARGE);
+    bench.batch(in.size()).unit("byte").run([&] {
+        enc.Encrypt(in.data(), in.size(), out.data());
+    });
+}
+
+static void AES256CBC_DECRYPT_1MB(benchmark::Bench& bench)
+{
+    std::vector<unsigned char> key(AES256_KEYSIZE, 0x11), iv(AES_BLOCKSIZE, 0x22);
+    AES256CBCDecrypt dec(key.data(), iv.data(), false);
+    std::vector<unsigned char> in(BUFFER_SIZE_LARGE, 0), out(BUFFER_SIZE_LARGE);
+    bench.batch(in.size()).unit("byte").run([&] {
+        dec.Decrypt(in.data(), in.size(), out.data());
+    });
+}
+
+/* Encryption of a 32-byte secret with its own IV, as the wallet does for each private key. */
+static void AES256CBC_ENCRYPT_KEY(benchmark::Bench& bench)
+{
+    std::vector<unsigned char> key(AES256_KEYSIZE, 0x11), iv(AES_BLOCKSIZE, 0x22);
+    std::vector<unsigned char> in(32, 0x33), out(48);
+    bench.run([&] {
+        AES256CBCEncrypt enc(key.data(), iv.data(), true);
+        enc.Encrypt(in.data(), in.size(), out.data());
+        ++iv[0];
+    });
+}
+
+static void AES256CBC_DECRYPT_KEY(benchmark::Bench& bench)
+{
+    std::vector<unsigned char> key(AES256_KEYSIZE, 0x11), iv(AES_BLOCKSIZE, 0x22);
+    std::vector<unsigned char> in(48), out(48);
+    AES256CBCEncrypt(key.data(), iv.data(), true).Encrypt(std::vector<unsigned char>(32, 0x33).data(), 32, in.data());
+    bench.run([&] {
+        AES256CBCDecrypt dec(key.data(), iv.data(), true);
+        int len = dec.Decrypt(in.data(), in.size(), out.data());
+        assert(len == 32);
+    });
+}
+
+BENCHMARK(AES256CBC_ENCRYPT_1MB);
+BENCHMARK(AES256CBC_DECRYPT_1MB);
+BENCHMARK(AES256CBC_ENCRYPT_KEY);
+BENCHMARK(AES256CBC_DECRYPT_KEY);
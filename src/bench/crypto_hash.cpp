@@ -63,6 +63,16 @@ static void SHA256_32b(benchmark::Bench& bench)
     });
 }
 
+static void SHA256_250b(benchmark::Bench& bench)
+{
+    // The double SHA256 of a typical transaction, as done for txids
+    std::vector<uint8_t> in(250, 0);
+    bench.batch(in.size()).unit("byte").run([&] {
+        const uint256 hash{Hash(in)};
+        std::copy(hash.begin(), hash.end(), in.begin());
+    });
+}
+
 static void SHA256D64_1024(benchmark::Bench& bench)
 {
     std::vector<uint8_t> in(64 * 1024, 0);
@@ -71,6 +81,15 @@ static void SHA256D64_1024(benchmark::Bench& bench)
     });
 }
 
+static void SHA256D64_16(benchmark::Bench& bench)
+{
+    // A single pass of the widest (16 way) implementation, like a level near the top of a merkle tree
+    std::vector<uint8_t> in(64 * 16, 0);
+    bench.batch(in.size()).unit("byte").run([&] {
+        SHA256D64(in.data(), in.data(), 16);
+    });
+}
+
 static void SHA512(benchmark::Bench& bench)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -89,6 +108,17 @@ static void SipHash_32b(benchmark::Bench& bench)
     });
 }
 
+static void SipHash_32b_Batch(benchmark::Bench& bench)
+{
+    std::vector<uint256> x(64);
+    std::vector<uint64_t> out(x.size());
+    uint64_t k1 = 0;
+    bench.batch(x.size()).unit("hash").run([&] {
+        SipHashUint256Batch(0, ++k1, x.data(), x.size(), out.data());
+        *((uint64_t*)x[0].begin()) = out.back();
+    });
+}
+
 static void FastRandom_32bit(benchmark::Bench& bench)
 {
     FastRandomContext rng(true);
@@ -112,7 +142,10 @@ BENCHMARK(SHA512);
 BENCHMARK(SHA3_256_1M);
 
 BENCHMARK(SHA256_32b);
+BENCHMARK(SHA256_250b);
 BENCHMARK(SipHash_32b);
+BENCHMARK(SipHash_32b_Batch);
 BENCHMARK(SHA256D64_1024);
+BENCHMARK(SHA256D64_16);
 BENCHMARK(FastRandom_32bit);
 BENCHMARK(FastRandom_1bit);
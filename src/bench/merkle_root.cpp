@@ -23,4 +23,20 @@ static void MerkleRoot(benchmark::Bench& bench)
     });
 }
 
+static void MerkleRootIncrementalUpdate(benchmark::Bench& bench)
+{
+    FastRandomContext rng(true);
+    IncrementalMerkleTree tree;
+    for (int i = 0; i < 9001; ++i) {
+        tree.Append(rng.rand256());
+    }
+    uint256 hash = rng.rand256();
+    bench.unit("update").run([&] {
+        // Replace the coinbase, as miners do when changing the extranonce
+        tree.Update(0, hash);
+        hash = tree.Root();
+    });
+}
+
 BENCHMARK(MerkleRoot);
+BENCHMARK(MerkleRootIncrementalUpdate);
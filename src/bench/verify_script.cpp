@@ -3,7 +3,9 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <bench/bench.h>
+#include <crypto/sha256.h>
 #include <key.h>
+#include <random.h>
 #if defined(HAVE_CONSENSUS_LIB)
 #include <script/bitcoinconsensus.h>
 #endif
@@ -75,6 +77,77 @@ static void VerifyScriptBench(benchmark::Bench& bench)
     ECC_Stop();
 }
 
+/** Signature checker accepting all signatures, to measure the script interpreter itself. */
+class AcceptingSignatureChecker : public BaseSignatureChecker
+{
+public:
+    bool CheckECDSASignature(Span<const unsigned char> sig, Span<const unsigned char> pubkey, const CScript& script_code, SigVersion sigversion) const override { return true; }
+    bool CheckSchnorrSignature(Span<const unsigned char> sig, Span<const unsigned char> pubkey, SigVersion sigversion, const ScriptExecutionData& execdata, ScriptError* serror) const override { return true; }
+};
+
+static std::vector<unsigned char> DummyPubKey(unsigned char n)
+{
+    std::vector<unsigned char> pubkey(CPubKey::COMPRESSED_SIZE, n);
+    pubkey[0] = 0x02;
+    return pubkey;
+}
+
+static std::vector<unsigned char> DummyECDSASignature()
+{
+    std::vector<unsigned char> sig(72, 0x11);
+    sig[0] = 0x30;
+    sig[1] = 69;
+    sig[2] = 0x02;
+    sig[3] = 33;
+    sig[4] = 0x00;
+    sig[5] = 0x81;
+    sig[37] = 0x02;
+    sig[38] = 32;
+    sig[71] = SIGHASH_ALL;
+    return sig;
+}
+
+// Interpreter overhead of a 2-of-3 P2WSH multisig spend, without the cost of
+// signature validation.
+static void VerifyScriptP2WSHMultisig(benchmark::Bench& bench)
+{
+    const int flags = SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC | SCRIPT_VERIFY_DERSIG | SCRIPT_VERIFY_LOW_S | SCRIPT_VERIFY_NULLDUMMY;
+    const CScript witness_script = CScript() << OP_2 << DummyPubKey(1) << DummyPubKey(2) << DummyPubKey(3) << OP_3 << OP_CHECKMULTISIG;
+    uint256 script_hash;
+    CSHA256().Write(witness_script.data(), witness_script.size()).Finalize(script_hash.begin());
+    const CScript script_pubkey = CScript() << OP_0 << ToByteVector(script_hash);
+    CScriptWitness witness;
+    witness.stack = {{}, DummyECDSASignature(), DummyECDSASignature(), std::vector<unsigned char>(witness_script.begin(), witness_script.end())};
+
+    bench.run([&] {
+        ScriptError err;
+        bool success = VerifyScript(CScript(), script_pubkey, &witness, flags, AcceptingSignatureChecker(), &err);
+        assert(err == SCRIPT_ERR_OK);
+        assert(success);
+    });
+}
+
+// Interpreter overhead of a 2-of-3 tapscript multisig (using OP_CHECKSIGADD),
+// without the cost of signature validation.
+static void VerifyTapscriptMultisig(benchmark::Bench& bench)
+{
+    std::vector<unsigned char> xonly_pubkeys[3];
+    for (unsigned char i = 0; i < 3; ++i) xonly_pubkeys[i] = std::vector<unsigned char>(32, i + 1);
+    const CScript script = CScript() << xonly_pubkeys[0] << OP_CHECKSIG << xonly_pubkeys[1] << OP_CHECKSIGADD << xonly_pubkeys[2] << OP_CHECKSIGADD << OP_2 << OP_NUMEQUAL;
+    const std::vector<std::vector<unsigned char>> stack{std::vector<unsigned char>(64, 0x22), {}, std::vector<unsigned char>(64, 0x11)};
+
+    bench.run([&] {
+        auto stack_copy = stack;
+        ScriptExecutionData execdata;
+        execdata.m_validation_weight_left = VALIDATION_WEIGHT_OFFSET + 1000;
+        execdata.m_validation_weight_left_init = true;
+        ScriptError error;
+        bool ret = EvalScript(stack_copy, script, SCRIPT_VERIFY_TAPROOT, AcceptingSignatureChecker(), SigVersion::TAPSCRIPT, execdata, &error);
+        assert(ret);
+        assert(stack_copy.size() == 1 && stack_copy[0] == std::vector<unsigned char>{1});
+    });
+}
+
 static void VerifyNestedIfScript(benchmark::Bench& bench)
 {
     std::vector<std::vector<unsigned char>> stack;
@@ -96,5 +169,49 @@ static void VerifyNestedIfScript(benchmark::Bench& bench)
     });
 }
 
+// Signature hashes of all inputs of a 100-input transaction, including the
+// precomputation shared between them.
+static void SignatureHashes(benchmark::Bench& bench, bool taproot)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(100);
+    tx.vout.resize(2);
+    std::vector<CTxOut> spent_outputs;
+    for (size_t i = 0; i < tx.vin.size(); ++i) {
+        tx.vin[i].prevout = COutPoint(GetRandHash(), i);
+        if (taproot) {
+            tx.vin[i].scriptWitness.stack = {std::vector<unsigned char>(64)};
+            spent_outputs.emplace_back(1000, CScript() << OP_1 << std::vector<unsigned char>(WITNESS_V1_TAPROOT_SIZE, 1));
+        } else {
+            tx.vin[i].scriptWitness.stack = {std::vector<unsigned char>(72), std::vector<unsigned char>(33)};
+        }
+    }
+    const CScript script_code = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20) << OP_EQUALVERIFY << OP_CHECKSIG;
+    ScriptExecutionData execdata;
+    execdata.m_annex_init = true;
+    execdata.m_annex_present = false;
+
+    bench.run([&] {
+        PrecomputedTransactionData txdata;
+        txdata.Init(tx, std::vector<CTxOut>(spent_outputs));
+        uint256 sighash;
+        for (unsigned int i = 0; i < tx.vin.size(); ++i) {
+            if (taproot) {
+                SignatureHashSchnorr(sighash, execdata, tx, i, SIGHASH_DEFAULT, SigVersion::TAPROOT, txdata);
+            } else {
+                sighash = SignatureHash(script_code, tx, i, SIGHASH_ALL, 1000, SigVersion::WITNESS_V0, &txdata);
+            }
+        }
+        ankerl::nanobench::doNotOptimizeAway(sighash);
+    });
+}
+
+static void SignatureHashesWitnessV0(benchmark::Bench& bench) { SignatureHashes(bench, false); }
+static void SignatureHashesTaproot(benchmark::Bench& bench) { SignatureHashes(bench, true); }
+
 BENCHMARK(VerifyScriptBench);
+BENCHMARK(VerifyScriptP2WSHMultisig);
+BENCHMARK(VerifyTapscriptMultisig);
 BENCHMARK(VerifyNestedIfScript);
+BENCHMARK(SignatureHashesWitnessV0);
+BENCHMARK(SignatureHashesTaproot);
@@ -0,0 +1,55 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <key.h>
+#include <pubkey.h>
+#include <random.h>
+#include <uint256.h>
+#include <util/strencodings.h>
+
+#include <cassert>
+#include <vector>
+
+// The cost of these depends on the size of libsecp256k1's precomputed table of
+// multiples of the generator, set with ./configure --with-ecmult-window=SIZE
+// (see doc/benchmarking.md).
+
+static void ECDSAVerify(benchmark::Bench& bench)
+{
+    ECC_Start();
+    const ECCVerifyHandle verify_handle;
+
+    CKey key;
+    key.MakeNewKey(true);
+    const CPubKey pubkey = key.GetPubKey();
+    const uint256 hash = GetRandHash();
+    std::vector<unsigned char> sig;
+    const bool signed_ok = key.Sign(hash, sig);
+    assert(signed_ok);
+
+    bench.run([&] {
+        bool ret = pubkey.Verify(hash, sig);
+        assert(ret);
+    });
+    ECC_Stop();
+}
+
+static void SchnorrVerify(benchmark::Bench& bench)
+{
+    const ECCVerifyHandle verify_handle;
+
+    // Test vector 1 of BIP 340.
+    const XOnlyPubKey pubkey{ParseHex("DFF1D77F2A671C5F36183726DB2341BE58FEAE1DA2DECED843240F7B502BA659")};
+    const uint256 msg{ParseHex("243F6A8885A308D313198A2E03707344A4093822299F31D0082EFA98EC4E6C89")};
+    const std::vector<unsigned char> sig = ParseHex("6896BD60EEAE296DB48A229FF71DFE071BDE413E6D43F917DC8DCF8C78DE33418906D11AC976ABCCB20B091292BFF4EA897EFCB639EA871CFA95F6DE339E4B0A");
+
+    bench.run([&] {
+        bool ret = pubkey.VerifySchnorr(msg, sig);
+        assert(ret);
+    });
+}
+
+BENCHMARK(ECDSAVerify);
+BENCHMARK(SchnorrVerify);
@@ -14,18 +14,28 @@
 #include <validation.h>
 #include <util/system.h>
 
+#include <algorithm>
+#include <bitset>
 #include <unordered_map>
 
+/** Number of bits in the short ID prefilter used by PartiallyDownloadedBlock::InitData(). */
+static constexpr size_t SHORTTXID_FILTER_BITS = 1 << 16;
+/** Number of short IDs PartiallyDownloadedBlock::InitData() computes at once. */
+static constexpr size_t SHORTTXID_BATCH_SIZE = 64;
+
 CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block, bool fUseWTXID) :
         nonce(GetRand(std::numeric_limits<uint64_t>::max())),
         shorttxids(block.vtx.size() - 1), prefilledtxn(1), header(block) {
     FillShortTxIDSelector();
     //TODO: Use our mempool prior to block acceptance to predictively fill more than just the coinbase
     prefilledtxn[0] = {0, block.vtx[0]};
+    std::vector<uint256> txhashes;
+    txhashes.reserve(block.vtx.size() - 1);
     for (size_t i = 1; i < block.vtx.size(); i++) {
         const CTransaction& tx = *block.vtx[i];
-        shorttxids[i - 1] = GetShortID(fUseWTXID ? tx.GetWitnessHash() : tx.GetHash());
+        txhashes.push_back(fUseWTXID ? tx.GetWitnessHash() : tx.GetHash());
     }
+    GetShortIDs(txhashes.data(), txhashes.size(), shorttxids.data());
 }
 
 void CBlockHeaderAndShortTxIDs::FillShortTxIDSelector() const {
@@ -44,6 +54,14 @@ uint64_t CBlockHeaderAndShortTxIDs::GetShortID(const uint256& txhash) const {
     return SipHashUint256(shorttxidk0, shorttxidk1, txhash) & 0xffffffffffffL;
 }
 
+void CBlockHeaderAndShortTxIDs::GetShortIDs(const uint256* txhashes, size_t count, uint64_t* shortids) const {
+    static_assert(SHORTTXIDS_LENGTH == 6, "shorttxids calculation assumes 6-byte shorttxids");
+    SipHashUint256Batch(shorttxidk0, shorttxidk1, txhashes, count, shortids);
+    for (size_t i = 0; i < count; i++) {
+        shortids[i] &= 0xffffffffffffL;
+    }
+}
+
 
 
 ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn) {
@@ -79,11 +97,18 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
     // of short IDs, any highly-uneven distribution of elements can be safely treated as a
     // READ_STATUS_FAILED.
     std::unordered_map<uint64_t, uint16_t> shorttxids(cmpctblock.shorttxids.size());
+    // The short IDs are keyed by the block header and a per-connection nonce, so they
+    // have to be computed for every mempool transaction again for each compact block.
+    // Most of those transactions are not in the block though, and testing the low bits
+    // of their short ID against this small (L1-cache sized) bitset lets us skip the
+    // hash table lookup for almost all of them.
+    std::bitset<SHORTTXID_FILTER_BITS> shorttxid_filter;
     uint16_t index_offset = 0;
     for (size_t i = 0; i < cmpctblock.shorttxids.size(); i++) {
         while (txn_available[i + index_offset])
             index_offset++;
         shorttxids[cmpctblock.shorttxids[i]] = i + index_offset;
+        shorttxid_filter.set(cmpctblock.shorttxids[i] % SHORTTXID_FILTER_BITS);
         // To determine the chance that the number of entries in a bucket exceeds N,
         // we use the fact that the number of elements in a single bucket is
         // binomially distributed (with n = the number of shorttxids S, and p =
@@ -103,10 +128,20 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
         return READ_STATUS_FAILED; // Short ID collision
 
     std::vector<bool> have_txn(txn_available.size());
+    // Short IDs of the candidates are computed in batches, which allows them
+    // to be hashed in parallel.
+    uint256 batch_hashes[SHORTTXID_BATCH_SIZE];
+    uint64_t batch_shortids[SHORTTXID_BATCH_SIZE];
     {
     LOCK(pool->cs);
     for (size_t i = 0; i < pool->vTxHashes.size(); i++) {
-        uint64_t shortid = cmpctblock.GetShortID(pool->vTxHashes[i].first);
+        if (i % SHORTTXID_BATCH_SIZE == 0) {
+            const size_t count = std::min(SHORTTXID_BATCH_SIZE, pool->vTxHashes.size() - i);
+            for (size_t j = 0; j < count; j++) batch_hashes[j] = pool->vTxHashes[i + j].first;
+            cmpctblock.GetShortIDs(batch_hashes, count, batch_shortids);
+        }
+        uint64_t shortid = batch_shortids[i % SHORTTXID_BATCH_SIZE];
+        if (!shorttxid_filter.test(shortid % SHORTTXID_FILTER_BITS)) continue;
         std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
         if (idit != shorttxids.end()) {
             if (!have_txn[idit->second]) {
@@ -132,7 +167,13 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
     }
 
     for (size_t i = 0; i < extra_txn.size(); i++) {
-        uint64_t shortid = cmpctblock.GetShortID(extra_txn[i].first);
+        if (i % SHORTTXID_BATCH_SIZE == 0) {
+            const size_t count = std::min(SHORTTXID_BATCH_SIZE, extra_txn.size() - i);
+            for (size_t j = 0; j < count; j++) batch_hashes[j] = extra_txn[i + j].first;
+            cmpctblock.GetShortIDs(batch_hashes, count, batch_shortids);
+        }
+        uint64_t shortid = batch_shortids[i % SHORTTXID_BATCH_SIZE];
+        if (!shorttxid_filter.test(shortid % SHORTTXID_FILTER_BITS)) continue;
         std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
         if (idit != shorttxids.end()) {
             if (!have_txn[idit->second]) {
@@ -52,6 +52,9 @@ private:
     //! The temporary evaluation result.
     bool fAllOk;
 
+    //! The first check that failed, handed to the master when it finishes.
+    T m_failed_check;
+
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
@@ -63,7 +66,7 @@ private:
     unsigned int nBatchSize;
 
     /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster = false)
+    bool Loop(bool fMaster = false, T* pfailed = nullptr)
     {
         boost::condition_variable& cond = fMaster ? condMaster : condWorker;
         std::vector<T> vChecks;
@@ -89,6 +92,12 @@ private:
                     if (fMaster && nTodo == 0) {
                         nTotal--;
                         bool fRet = fAllOk;
+                        if (!fRet) {
+                            // vChecks is empty here and destroyed after the lock is released
+                            vChecks.emplace_back();
+                            vChecks.back().swap(m_failed_check);
+                            if (pfailed) pfailed->swap(vChecks.back());
+                        }
                         // reset the status for new work later
                         fAllOk = true;
                         // return the current status
@@ -115,9 +124,17 @@ private:
                 fOk = fAllOk;
             }
             // execute work
-            for (T& check : vChecks)
-                if (fOk)
+            for (T& check : vChecks) {
+                if (fOk) {
                     fOk = check();
+                    if (!fOk) {
+                        boost::unique_lock<boost::mutex> lock(mutex);
+                        // Keep the first failure only; this also stops the other workers early
+                        if (fAllOk) m_failed_check.swap(check);
+                        fAllOk = false;
+                    }
+                }
+            }
             vChecks.clear();
         } while (true);
     }
@@ -136,9 +153,10 @@ public:
     }
 
     //! Wait until execution finishes, and return whether all evaluations were successful.
-    bool Wait()
+    //! On failure, the first failing check is swapped into *pfailed if given.
+    bool Wait(T* pfailed = nullptr)
     {
-        return Loop(true);
+        return Loop(true, pfailed);
     }
 
     //! Add a batch of checks to the queue
@@ -185,11 +203,11 @@ public:
         }
     }
 
-    bool Wait()
+    bool Wait(T* pfailed = nullptr)
     {
         if (pqueue == nullptr)
             return true;
-        bool fRet = pqueue->Wait();
+        bool fRet = pqueue->Wait(pfailed);
         fDone = true;
         return fRet;
     }
@@ -5,6 +5,8 @@
 #include <consensus/merkle.h>
 #include <hash.h>
 
+#include <assert.h>
+
 /*     WARNING! If you're reading this because you're learning about crypto
        and/or designing a new system that will use merkle trees, keep in mind
        that the following merkle tree algorithm has a serious flaw related to
@@ -62,6 +64,58 @@ uint256 ComputeMerkleRoot(std::vector<uint256> hashes, bool* mutated) {
 }
 
 
+IncrementalMerkleTree::IncrementalMerkleTree(std::vector<uint256> leaves)
+{
+    if (leaves.empty()) return;
+    m_levels.push_back(std::move(leaves));
+    while (m_levels.back().size() > 1) {
+        const std::vector<uint256>& nodes = m_levels.back();
+        std::vector<uint256> parents((nodes.size() + 1) / 2);
+        SHA256D64(parents[0].begin(), nodes[0].begin(), nodes.size() / 2);
+        if (nodes.size() & 1) {
+            uint256 pair[2] = {nodes.back(), nodes.back()};
+            SHA256D64(parents.back().begin(), pair[0].begin(), 1);
+        }
+        m_levels.push_back(std::move(parents));
+    }
+}
+
+void IncrementalMerkleTree::UpdatePath(size_t pos)
+{
+    for (size_t level = 0; m_levels[level].size() > 1; ++level) {
+        const std::vector<uint256>& nodes = m_levels[level];
+        const size_t parent = pos / 2;
+        // As in ComputeMerkleRoot, the last node of a level with an odd number
+        // of nodes is paired with itself.
+        uint256 pair[2] = {nodes[parent * 2], parent * 2 + 1 < nodes.size() ? nodes[parent * 2 + 1] : nodes[parent * 2]};
+        if (level + 1 == m_levels.size()) m_levels.emplace_back();
+        std::vector<uint256>& parents = m_levels[level + 1];
+        if (parent == parents.size()) parents.emplace_back();
+        SHA256D64(parents[parent].begin(), pair[0].begin(), 1);
+        pos = parent;
+    }
+}
+
+void IncrementalMerkleTree::Append(const uint256& leaf)
+{
+    if (m_levels.empty()) m_levels.emplace_back();
+    m_levels[0].push_back(leaf);
+    UpdatePath(m_levels[0].size() - 1);
+}
+
+void IncrementalMerkleTree::Update(size_t pos, const uint256& leaf)
+{
+    assert(pos < Size());
+    m_levels[0][pos] = leaf;
+    UpdatePath(pos);
+}
+
+uint256 IncrementalMerkleTree::Root() const
+{
+    if (m_levels.empty()) return uint256();
+    return m_levels.back()[0];
+}
+
 uint256 BlockMerkleRoot(const CBlock& block, bool* mutated)
 {
     std::vector<uint256> leaves;
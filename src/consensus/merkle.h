@@ -24,4 +24,31 @@ uint256 BlockMerkleRoot(const CBlock& block, bool* mutated = nullptr);
  */
 uint256 BlockWitnessMerkleRoot(const CBlock& block, bool* mutated = nullptr);
 
+/**
+ * Merkle tree over a list of leaves that can be appended to and modified,
+ * computing the same root as ComputeMerkleRoot. All inner nodes are kept, so
+ * appending or replacing a leaf only rehashes the nodes on its path to the
+ * root (O(log n) hashes instead of O(n) for a full recomputation). This is
+ * useful to miners that change the coinbase (leaf 0) of a template or append
+ * transactions to it. Unlike ComputeMerkleRoot, mutations are not detected.
+ */
+class IncrementalMerkleTree
+{
+private:
+    //! m_levels[0] are the leaves, every following level the hashes of pairs of nodes of the level below.
+    std::vector<std::vector<uint256>> m_levels;
+
+    void UpdatePath(size_t pos);
+
+public:
+    IncrementalMerkleTree() = default;
+    /** Build the tree over the given leaves, hashing every level in batches. */
+    explicit IncrementalMerkleTree(std::vector<uint256> leaves);
+
+    void Append(const uint256& leaf);
+    void Update(size_t pos, const uint256& leaf);
+    size_t Size() const { return m_levels.empty() ? 0 : m_levels[0].size(); }
+    uint256 Root() const;
+};
+
 #endif // BITCOIN_CONSENSUS_MERKLE_H
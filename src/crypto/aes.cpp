@@ -3,41 +3,114 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <crypto/aes.h>
+#include <crypto/common.h>
 
+#include <assert.h>
 #include <string.h>
 
+#include <compat/cpuid.h>
+
+#if defined(ENABLE_ARM_AES) && !defined(BUILD_BITCOIN_INTERNAL)
+#if defined(__linux__) && defined(HAVE_STRONG_GETAUXVAL)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+#if defined(MAC_OSX)
+#include <sys/sysctl.h>
+#include <sys/types.h>
+#endif
+#endif
+
 extern "C" {
 #include <crypto/ctaes/ctaes.c>
 }
 
-AES256Encrypt::AES256Encrypt(const unsigned char key[32])
+namespace aes256_aesni
+{
+void ExpandKey(unsigned char rk[240], const unsigned char key[32]);
+void InvertKey(unsigned char drk[240], const unsigned char rk[240]);
+void Encrypt(const unsigned char rk[240], unsigned char* out, const unsigned char* in, size_t blocks);
+void Decrypt(const unsigned char drk[240], unsigned char* out, const unsigned char* in, size_t blocks);
+}
+
+namespace aes256_arm
 {
-    AES256_init(&ctx, key);
+void ExpandKey(unsigned char rk[240], const unsigned char key[32]);
+void InvertKey(unsigned char drk[240], const unsigned char rk[240]);
+void Encrypt(const unsigned char rk[240], unsigned char* out, const unsigned char* in, size_t blocks);
+void Decrypt(const unsigned char drk[240], unsigned char* out, const unsigned char* in, size_t blocks);
+}
+
+namespace {
+// The hardware implementation selected by AES256AutoDetect, if any. Its
+// decryption round keys are those of the equivalent inverse cipher of FIPS 197.
+typedef void (*KeyFn)(unsigned char*, const unsigned char*);
+typedef void (*BlocksFn)(const unsigned char*, unsigned char*, const unsigned char*, size_t);
+KeyFn ExpandKey = nullptr;
+KeyFn InvertKey = nullptr;
+BlocksFn EncryptBlocks = nullptr;
+BlocksFn DecryptBlocks = nullptr;
+} // namespace
+
+AES256Encrypt::AES256Encrypt(const unsigned char key[32]) : hw(ExpandKey != nullptr)
+{
+    if (hw) {
+        ExpandKey(rk, key);
+    } else {
+        AES256_init(&ctx, key);
+    }
 }
 
 AES256Encrypt::~AES256Encrypt()
 {
     memset(&ctx, 0, sizeof(ctx));
+    memset(rk, 0, sizeof(rk));
 }
 
 void AES256Encrypt::Encrypt(unsigned char ciphertext[16], const unsigned char plaintext[16]) const
 {
-    AES256_encrypt(&ctx, 1, ciphertext, plaintext);
+    Encrypt(ciphertext, plaintext, 1);
 }
 
-AES256Decrypt::AES256Decrypt(const unsigned char key[32])
+void AES256Encrypt::Encrypt(unsigned char* ciphertext, const unsigned char* plaintext, size_t blocks) const
 {
-    AES256_init(&ctx, key);
+    if (hw) {
+        EncryptBlocks(rk, ciphertext, plaintext, blocks);
+    } else {
+        AES256_encrypt(&ctx, blocks, ciphertext, plaintext);
+    }
+}
+
+AES256Decrypt::AES256Decrypt(const unsigned char key[32]) : hw(ExpandKey != nullptr)
+{
+    if (hw) {
+        unsigned char enc_rk[AES256_ROUNDKEYSSIZE];
+        ExpandKey(enc_rk, key);
+        InvertKey(rk, enc_rk);
+        memset(enc_rk, 0, sizeof(enc_rk));
+    } else {
+        AES256_init(&ctx, key);
+    }
 }
 
 AES256Decrypt::~AES256Decrypt()
 {
     memset(&ctx, 0, sizeof(ctx));
+    memset(rk, 0, sizeof(rk));
 }
 
 void AES256Decrypt::Decrypt(unsigned char plaintext[16], const unsigned char ciphertext[16]) const
 {
-    AES256_decrypt(&ctx, 1, plaintext, ciphertext);
+    Decrypt(plaintext, ciphertext, 1);
+}
+
+void AES256Decrypt::Decrypt(unsigned char* plaintext, const unsigned char* ciphertext, size_t blocks) const
+{
+    if (hw) {
+        DecryptBlocks(rk, plaintext, ciphertext, blocks);
+    } else {
+        AES256_decrypt(&ctx, blocks, plaintext, ciphertext);
+    }
 }
 
 
@@ -91,8 +164,8 @@ static int CBCDecrypt(const T& dec, const unsigned char iv[AES_BLOCKSIZE], const
         return 0;
 
     // Decrypt all data. Padding will be checked in the output.
+    dec.Decrypt(out, data, size / AES_BLOCKSIZE);
     while (written != size) {
-        dec.Decrypt(out, data + written);
         for (int i = 0; i != AES_BLOCKSIZE; i++)
             *out++ ^= prev[i];
         prev = data + written;
@@ -150,3 +223,66 @@ AES256CBCDecrypt::~AES256CBCDecrypt()
 {
     memset(iv, 0, sizeof(iv));
 }
+
+namespace {
+/** Check the selected implementation against the AES-256 example of FIPS 197. */
+bool SelfTest()
+{
+    static const unsigned char key[32] = {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+        0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f};
+    static const unsigned char plaintext[16] = {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+    static const unsigned char ciphertext[16] = {
+        0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf, 0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89};
+    unsigned char out[16];
+    AES256Encrypt(key).Encrypt(out, plaintext);
+    if (memcmp(out, ciphertext, sizeof(out))) return false;
+    AES256Decrypt(key).Decrypt(out, ciphertext);
+    return memcmp(out, plaintext, sizeof(out)) == 0;
+}
+} // namespace
+
+std::string AES256AutoDetect()
+{
+    std::string ret = "ctaes";
+#if defined(USE_ASM) && defined(HAVE_GETCPUID) && defined(ENABLE_AESNI) && !defined(BUILD_BITCOIN_INTERNAL)
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    if ((ecx >> 25) & 1) {
+        ExpandKey = aes256_aesni::ExpandKey;
+        InvertKey = aes256_aesni::InvertKey;
+        EncryptBlocks = aes256_aesni::Encrypt;
+        DecryptBlocks = aes256_aesni::Decrypt;
+        ret = "aesni";
+    }
+#endif
+
+#if defined(USE_ASM) && defined(ENABLE_ARM_AES) && !defined(BUILD_BITCOIN_INTERNAL)
+    bool have_arm_aes = false;
+#if defined(__linux__) && defined(HAVE_STRONG_GETAUXVAL)
+#if defined(__aarch64__)
+    have_arm_aes = getauxval(AT_HWCAP) & HWCAP_AES;
+#elif defined(__arm__)
+    have_arm_aes = getauxval(AT_HWCAP2) & HWCAP2_AES;
+#endif
+#endif
+#if defined(MAC_OSX)
+    int val = 0;
+    size_t len = sizeof(val);
+    if (sysctlbyname("hw.optional.arm.FEAT_AES", &val, &len, nullptr, 0) == 0) {
+        have_arm_aes = val != 0;
+    }
+#endif
+    if (have_arm_aes) {
+        ExpandKey = aes256_arm::ExpandKey;
+        InvertKey = aes256_arm::InvertKey;
+        EncryptBlocks = aes256_arm::Encrypt;
+        DecryptBlocks = aes256_arm::Decrypt;
+        ret = "arm_aes";
+    }
+#endif
+
+    assert(SelfTest());
+    return ret;
+}
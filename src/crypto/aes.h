@@ -2,7 +2,8 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 //
-// C++ wrapper around ctaes, a constant-time AES implementation
+// C++ wrapper around constant-time AES implementations: the AES-NI or ARMv8
+// instructions when available, and ctaes otherwise.
 
 #ifndef BITCOIN_CRYPTO_AES_H
 #define BITCOIN_CRYPTO_AES_H
@@ -11,19 +12,29 @@ extern "C" {
 #include <crypto/ctaes/ctaes.h>
 }
 
+#include <stddef.h>
+#include <string>
+
 static const int AES_BLOCKSIZE = 16;
 static const int AES256_KEYSIZE = 32;
+//! Size of the 15 round keys of AES-256.
+static const int AES256_ROUNDKEYSSIZE = 240;
 
 /** An encryption class for AES-256. */
 class AES256Encrypt
 {
 private:
     AES256_ctx ctx;
+    //! Round keys for the hardware implementation, if one was in use when this was constructed.
+    alignas(16) unsigned char rk[AES256_ROUNDKEYSSIZE];
+    bool hw;
 
 public:
     explicit AES256Encrypt(const unsigned char key[32]);
     ~AES256Encrypt();
     void Encrypt(unsigned char ciphertext[16], const unsigned char plaintext[16]) const;
+    /** Encrypt blocks independent blocks. */
+    void Encrypt(unsigned char* ciphertext, const unsigned char* plaintext, size_t blocks) const;
 };
 
 /** A decryption class for AES-256. */
@@ -31,11 +42,16 @@ class AES256Decrypt
 {
 private:
     AES256_ctx ctx;
+    //! Round keys for the hardware implementation, if one was in use when this was constructed.
+    alignas(16) unsigned char rk[AES256_ROUNDKEYSSIZE];
+    bool hw;
 
 public:
     explicit AES256Decrypt(const unsigned char key[32]);
     ~AES256Decrypt();
     void Decrypt(unsigned char plaintext[16], const unsigned char ciphertext[16]) const;
+    /** Decrypt blocks independent blocks, which is faster than one at a time with hardware support. */
+    void Decrypt(unsigned char* plaintext, const unsigned char* ciphertext, size_t blocks) const;
 };
 
 class AES256CBCEncrypt
@@ -64,4 +80,10 @@ private:
     unsigned char iv[AES_BLOCKSIZE];
 };
 
+/** Autodetect the best available AES-256 implementation.
+ *  Returns the name of the implementation.
+ *  Objects constructed before this keep using ctaes.
+ */
+std::string AES256AutoDetect();
+
 #endif // BITCOIN_CRYPTO_AES_H
@@ -0,0 +1,123 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// AES-256 using the AES-NI instructions, which run in constant time.
+
+#ifdef ENABLE_AESNI
+
+#include <stddef.h>
+#include <immintrin.h>
+
+namespace aes256_aesni {
+namespace {
+
+__m128i inline Load(const unsigned char* in) { return _mm_loadu_si128((const __m128i*)in); }
+void inline Store(unsigned char* out, __m128i x) { _mm_storeu_si128((__m128i*)out, x); }
+
+/** Compute the next round key from the one two rounds back and the output of AESKEYGENASSIST. */
+__m128i inline NextKey(__m128i key, __m128i assist)
+{
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+}
+
+/** Compute round keys 2*i and 2*i+1 from the previous two, where rcon is the i-th round constant. */
+template <int rcon>
+void inline ExpandRound(__m128i& k0, __m128i& k1, unsigned char* rk)
+{
+    k0 = NextKey(k0, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(k1, rcon), 0xff));
+    Store(rk, k0);
+    k1 = NextKey(k1, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(k0, 0), 0xaa));
+    Store(rk + 16, k1);
+}
+
+} // namespace
+
+void ExpandKey(unsigned char rk[240], const unsigned char key[32])
+{
+    __m128i k0 = Load(key), k1 = Load(key + 16);
+    Store(rk, k0);
+    Store(rk + 16, k1);
+    ExpandRound<0x01>(k0, k1, rk + 32);
+    ExpandRound<0x02>(k0, k1, rk + 64);
+    ExpandRound<0x04>(k0, k1, rk + 96);
+    ExpandRound<0x08>(k0, k1, rk + 128);
+    ExpandRound<0x10>(k0, k1, rk + 160);
+    ExpandRound<0x20>(k0, k1, rk + 192);
+    // Round 14 is the last, only its first key is needed.
+    k0 = NextKey(k0, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(k1, 0x40), 0xff));
+    Store(rk + 224, k0);
+}
+
+void InvertKey(unsigned char drk[240], const unsigned char rk[240])
+{
+    Store(drk, Load(rk + 224));
+    for (int i = 1; i < 14; ++i) {
+        Store(drk + 16 * i, _mm_aesimc_si128(Load(rk + 224 - 16 * i)));
+    }
+    Store(drk + 224, Load(rk));
+}
+
+void Encrypt(const unsigned char rk[240], unsigned char* out, const unsigned char* in, size_t blocks)
+{
+    __m128i k[15];
+    for (int i = 0; i < 15; ++i) k[i] = Load(rk + 16 * i);
+
+    // Interleave four independent blocks to hide the latency of AESENC.
+    for (; blocks >= 4; blocks -= 4, in += 64, out += 64) {
+        __m128i s0 = _mm_xor_si128(Load(in), k[0]);
+        __m128i s1 = _mm_xor_si128(Load(in + 16), k[0]);
+        __m128i s2 = _mm_xor_si128(Load(in + 32), k[0]);
+        __m128i s3 = _mm_xor_si128(Load(in + 48), k[0]);
+        for (int i = 1; i < 14; ++i) {
+            s0 = _mm_aesenc_si128(s0, k[i]);
+            s1 = _mm_aesenc_si128(s1, k[i]);
+            s2 = _mm_aesenc_si128(s2, k[i]);
+            s3 = _mm_aesenc_si128(s3, k[i]);
+        }
+        Store(out, _mm_aesenclast_si128(s0, k[14]));
+        Store(out + 16, _mm_aesenclast_si128(s1, k[14]));
+        Store(out + 32, _mm_aesenclast_si128(s2, k[14]));
+        Store(out + 48, _mm_aesenclast_si128(s3, k[14]));
+    }
+    for (; blocks; --blocks, in += 16, out += 16) {
+        __m128i s = _mm_xor_si128(Load(in), k[0]);
+        for (int i = 1; i < 14; ++i) s = _mm_aesenc_si128(s, k[i]);
+        Store(out, _mm_aesenclast_si128(s, k[14]));
+    }
+}
+
+void Decrypt(const unsigned char drk[240], unsigned char* out, const unsigned char* in, size_t blocks)
+{
+    __m128i k[15];
+    for (int i = 0; i < 15; ++i) k[i] = Load(drk + 16 * i);
+
+    for (; blocks >= 4; blocks -= 4, in += 64, out += 64) {
+        __m128i s0 = _mm_xor_si128(Load(in), k[0]);
+        __m128i s1 = _mm_xor_si128(Load(in + 16), k[0]);
+        __m128i s2 = _mm_xor_si128(Load(in + 32), k[0]);
+        __m128i s3 = _mm_xor_si128(Load(in + 48), k[0]);
+        for (int i = 1; i < 14; ++i) {
+            s0 = _mm_aesdec_si128(s0, k[i]);
+            s1 = _mm_aesdec_si128(s1, k[i]);
+            s2 = _mm_aesdec_si128(s2, k[i]);
+            s3 = _mm_aesdec_si128(s3, k[i]);
+        }
+        Store(out, _mm_aesdeclast_si128(s0, k[14]));
+        Store(out + 16, _mm_aesdeclast_si128(s1, k[14]));
+        Store(out + 32, _mm_aesdeclast_si128(s2, k[14]));
+        Store(out + 48, _mm_aesdeclast_si128(s3, k[14]));
+    }
+    for (; blocks; --blocks, in += 16, out += 16) {
+        __m128i s = _mm_xor_si128(Load(in), k[0]);
+        for (int i = 1; i < 14; ++i) s = _mm_aesdec_si128(s, k[i]);
+        Store(out, _mm_aesdeclast_si128(s, k[14]));
+    }
+}
+
+} // namespace aes256_aesni
+
+#endif
@@ -0,0 +1,108 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// AES-256 using the ARMv8 cryptography extensions, which run in constant time.
+
+#ifdef ENABLE_ARM_AES
+
+#include <crypto/common.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <arm_neon.h>
+
+namespace aes256_arm {
+namespace {
+
+/** Apply the S-box to each byte of w, using AESE so that this runs in constant time. */
+uint32_t inline SubWord(uint32_t w)
+{
+    // With all four columns equal to w, ShiftRows has no effect and AESE with a zero
+    // round key only substitutes the bytes.
+    return vgetq_lane_u32(vreinterpretq_u32_u8(vaeseq_u8(vreinterpretq_u8_u32(vdupq_n_u32(w)), vdupq_n_u8(0))), 0);
+}
+
+} // namespace
+
+void ExpandKey(unsigned char rk[240], const unsigned char key[32])
+{
+    static constexpr uint32_t RCON[7] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40};
+    // Words are little endian, so that the first byte of a word is its lowest.
+    uint32_t w[60];
+    for (int i = 0; i < 8; ++i) w[i] = ReadLE32(key + 4 * i);
+    for (int i = 8; i < 60; ++i) {
+        uint32_t t = w[i - 1];
+        if (i % 8 == 0) {
+            t = ((SubWord(t) >> 8) | (SubWord(t) << 24)) ^ RCON[i / 8 - 1];
+        } else if (i % 8 == 4) {
+            t = SubWord(t);
+        }
+        w[i] = w[i - 8] ^ t;
+    }
+    for (int i = 0; i < 60; ++i) WriteLE32(rk + 4 * i, w[i]);
+}
+
+void InvertKey(unsigned char drk[240], const unsigned char rk[240])
+{
+    vst1q_u8(drk, vld1q_u8(rk + 224));
+    for (int i = 1; i < 14; ++i) {
+        vst1q_u8(drk + 16 * i, vaesimcq_u8(vld1q_u8(rk + 224 - 16 * i)));
+    }
+    vst1q_u8(drk + 224, vld1q_u8(rk));
+}
+
+void Encrypt(const unsigned char rk[240], unsigned char* out, const unsigned char* in, size_t blocks)
+{
+    uint8x16_t k[15];
+    for (int i = 0; i < 15; ++i) k[i] = vld1q_u8(rk + 16 * i);
+
+    // Interleave four independent blocks to hide the latency of AESE/AESMC.
+    for (; blocks >= 4; blocks -= 4, in += 64, out += 64) {
+        uint8x16_t s0 = vld1q_u8(in), s1 = vld1q_u8(in + 16), s2 = vld1q_u8(in + 32), s3 = vld1q_u8(in + 48);
+        for (int i = 0; i < 13; ++i) {
+            s0 = vaesmcq_u8(vaeseq_u8(s0, k[i]));
+            s1 = vaesmcq_u8(vaeseq_u8(s1, k[i]));
+            s2 = vaesmcq_u8(vaeseq_u8(s2, k[i]));
+            s3 = vaesmcq_u8(vaeseq_u8(s3, k[i]));
+        }
+        vst1q_u8(out, veorq_u8(vaeseq_u8(s0, k[13]), k[14]));
+        vst1q_u8(out + 16, veorq_u8(vaeseq_u8(s1, k[13]), k[14]));
+        vst1q_u8(out + 32, veorq_u8(vaeseq_u8(s2, k[13]), k[14]));
+        vst1q_u8(out + 48, veorq_u8(vaeseq_u8(s3, k[13]), k[14]));
+    }
+    for (; blocks; --blocks, in += 16, out += 16) {
+        uint8x16_t s = vld1q_u8(in);
+        for (int i = 0; i < 13; ++i) s = vaesmcq_u8(vaeseq_u8(s, k[i]));
+        vst1q_u8(out, veorq_u8(vaeseq_u8(s, k[13]), k[14]));
+    }
+}
+
+void Decrypt(const unsigned char drk[240], unsigned char* out, const unsigned char* in, size_t blocks)
+{
+    uint8x16_t k[15];
+    for (int i = 0; i < 15; ++i) k[i] = vld1q_u8(drk + 16 * i);
+
+    for (; blocks >= 4; blocks -= 4, in += 64, out += 64) {
+        uint8x16_t s0 = vld1q_u8(in), s1 = vld1q_u8(in + 16), s2 = vld1q_u8(in + 32), s3 = vld1q_u8(in + 48);
+        for (int i = 0; i < 13; ++i) {
+            s0 = vaesimcq_u8(vaesdq_u8(s0, k[i]));
+            s1 = vaesimcq_u8(vaesdq_u8(s1, k[i]));
+            s2 = vaesimcq_u8(vaesdq_u8(s2, k[i]));
+            s3 = vaesimcq_u8(vaesdq_u8(s3, k[i]));
+        }
+        vst1q_u8(out, veorq_u8(vaesdq_u8(s0, k[13]), k[14]));
+        vst1q_u8(out + 16, veorq_u8(vaesdq_u8(s1, k[13]), k[14]));
+        vst1q_u8(out + 32, veorq_u8(vaesdq_u8(s2, k[13]), k[14]));
+        vst1q_u8(out + 48, veorq_u8(vaesdq_u8(s3, k[13]), k[14]));
+    }
+    for (; blocks; --blocks, in += 16, out += 16) {
+        uint8x16_t s = vld1q_u8(in);
+        for (int i = 0; i < 13; ++i) s = vaesimcq_u8(vaesdq_u8(s, k[i]));
+        vst1q_u8(out, veorq_u8(vaesdq_u8(s, k[13]), k[14]));
+    }
+}
+
+} // namespace aes256_arm
+
+#endif
@@ -7,9 +7,22 @@
 
 #include <crypto/common.h>
 #include <crypto/chacha20.h>
+#include <compat/cpuid.h>
 
 #include <string.h>
 
+#if defined(__GNUC__) && (defined(__SSE2__) || defined(__ARM_NEON))
+#include <crypto/chacha20_vec.h>
+#define ENABLE_CHACHA20_VEC4
+#endif
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+namespace chacha20_avx2
+{
+void Crypt_8way(uint32_t input[16], const unsigned char* m, unsigned char* c, size_t blocks);
+}
+#endif
+
 constexpr static inline uint32_t rotl32(uint32_t v, int c) { return (v << c) | (v >> (32 - c)); }
 
 #define QUARTERROUND(a,b,c,d) \
@@ -21,6 +34,33 @@ constexpr static inline uint32_t rotl32(uint32_t v, int c) { return (v << c) | (
 static const unsigned char sigma[] = "expand 32-byte k";
 static const unsigned char tau[] = "expand 16-byte k";
 
+/** Process as many whole blocks of the input as the multi-block implementations
+ *  available on this machine can, and return the number of bytes done. The
+ *  remainder is left to the one block at a time code below. */
+static size_t CryptBlocksParallel(uint32_t input[16], const unsigned char* m, unsigned char* c, size_t bytes)
+{
+    size_t done = 0;
+    (void)input;
+    (void)m;
+    (void)c;
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL) && defined(HAVE_GETCPUID)
+    static const bool have_avx2{HaveAVX2()};
+    if (have_avx2 && bytes >= 8 * 64) {
+        const size_t blocks = bytes / 64 & ~size_t{7};
+        chacha20_avx2::Crypt_8way(input, m, c, blocks);
+        done = blocks * 64;
+    }
+#endif
+#ifdef ENABLE_CHACHA20_VEC4
+    if (bytes - done >= 4 * 64) {
+        const size_t blocks = (bytes - done) / 64 & ~size_t{3};
+        ChaCha20CryptLanes<4>(input, m ? m + done : nullptr, c + done, blocks);
+        done += blocks * 64;
+    }
+#endif
+    return done;
+}
+
 void ChaCha20::SetKey(const unsigned char* k, size_t keylen)
 {
     const unsigned char *constants;
@@ -81,6 +121,11 @@ void ChaCha20::Keystream(unsigned char* c, size_t bytes)
 
     if (!bytes) return;
 
+    const size_t done = CryptBlocksParallel(input, nullptr, c, bytes);
+    c += done;
+    bytes -= done;
+    if (!bytes) return;
+
     j0 = input[0];
     j1 = input[1];
     j2 = input[2];
@@ -189,6 +234,12 @@ void ChaCha20::Crypt(const unsigned char* m, unsigned char* c, size_t bytes)
 
     if (!bytes) return;
 
+    const size_t done = CryptBlocksParallel(input, m, c, bytes);
+    c += done;
+    m += done;
+    bytes -= done;
+    if (!bytes) return;
+
     j0 = input[0];
     j1 = input[1];
     j2 = input[2];
@@ -0,0 +1,19 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX2
+
+#include <crypto/chacha20_vec.h>
+
+namespace chacha20_avx2 {
+
+/** ChaCha20 of eight blocks at a time, one per 32-bit lane of the AVX2 registers. */
+void Crypt_8way(uint32_t input[16], const unsigned char* m, unsigned char* c, size_t blocks)
+{
+    ChaCha20CryptLanes<8>(input, m, c, blocks);
+}
+
+}
+
+#endif
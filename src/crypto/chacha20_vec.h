@@ -0,0 +1,89 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Internal to crypto/: ChaCha20 of several blocks in parallel, using the
+// compiler's generic vector types so that the same code compiles to SSE2, AVX2
+// or NEON depending on the flags of the including file.
+
+#ifndef BITCOIN_CRYPTO_CHACHA20_VEC_H
+#define BITCOIN_CRYPTO_CHACHA20_VEC_H
+
+#include <crypto/common.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/** Vector of LANES 32-bit words. */
+template <size_t LANES> struct ChaCha20Vec;
+template <> struct ChaCha20Vec<4> { typedef uint32_t type __attribute__((vector_size(16))); };
+template <> struct ChaCha20Vec<8> { typedef uint32_t type __attribute__((vector_size(32))); };
+
+/** Encrypt (or with m == nullptr, output the keystream of) blocks whole 64-byte
+ *  blocks, a multiple of LANES, and advance the block counter in input.
+ *
+ *  Each vector holds the same state word of LANES consecutive blocks, so the
+ *  rounds need no shuffles. This is static so that each file using it gets its
+ *  own copy, compiled with that file's instruction set.
+ */
+template <size_t LANES>
+static inline void ChaCha20CryptLanes(uint32_t input[16], const unsigned char* m, unsigned char* c, size_t blocks)
+{
+    typedef typename ChaCha20Vec<LANES>::type vec;
+
+    vec j[16];
+    for (int w = 0; w < 16; ++w) {
+        for (size_t i = 0; i < LANES; ++i) j[w][i] = input[w];
+    }
+    uint64_t counter = input[12] | ((uint64_t)input[13] << 32);
+
+    for (; blocks; blocks -= LANES) {
+        for (size_t i = 0; i < LANES; ++i) {
+            j[12][i] = counter + i;
+            j[13][i] = (counter + i) >> 32;
+        }
+        counter += LANES;
+
+        vec x[16];
+        for (int w = 0; w < 16; ++w) x[w] = j[w];
+        for (int r = 0; r < 10; ++r) {
+#define QUARTERROUND_VEC(a,b,c,d) \
+            x[a] += x[b]; x[d] ^= x[a]; x[d] = (x[d] << 16) | (x[d] >> 16); \
+            x[c] += x[d]; x[b] ^= x[c]; x[b] = (x[b] << 12) | (x[b] >> 20); \
+            x[a] += x[b]; x[d] ^= x[a]; x[d] = (x[d] << 8) | (x[d] >> 24); \
+            x[c] += x[d]; x[b] ^= x[c]; x[b] = (x[b] << 7) | (x[b] >> 25);
+            QUARTERROUND_VEC(0, 4, 8, 12)
+            QUARTERROUND_VEC(1, 5, 9, 13)
+            QUARTERROUND_VEC(2, 6, 10, 14)
+            QUARTERROUND_VEC(3, 7, 11, 15)
+            QUARTERROUND_VEC(0, 5, 10, 15)
+            QUARTERROUND_VEC(1, 6, 11, 12)
+            QUARTERROUND_VEC(2, 7, 8, 13)
+            QUARTERROUND_VEC(3, 4, 9, 14)
+#undef QUARTERROUND_VEC
+        }
+        for (int w = 0; w < 16; ++w) x[w] += j[w];
+
+        // Lane i of word w is word w of the i-th block.
+        uint32_t words[16][LANES];
+        memcpy(words, x, sizeof(words));
+        if (m) {
+            for (size_t i = 0; i < LANES; ++i) {
+                for (int w = 0; w < 16; ++w) WriteLE32(c + 4 * w, words[w][i] ^ ReadLE32(m + 4 * w));
+                c += 64;
+                m += 64;
+            }
+        } else {
+            for (size_t i = 0; i < LANES; ++i) {
+                for (int w = 0; w < 16; ++w) WriteLE32(c + 4 * w, words[w][i]);
+                c += 64;
+            }
+        }
+    }
+
+    input[12] = counter;
+    input[13] = counter >> 32;
+}
+
+#endif // BITCOIN_CRYPTO_CHACHA20_VEC_H
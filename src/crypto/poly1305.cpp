@@ -7,9 +7,17 @@
 
 #include <crypto/common.h>
 #include <crypto/poly1305.h>
+#include <compat/cpuid.h>
 
 #include <string.h>
 
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+namespace poly1305_avx2
+{
+void Blocks_4way(uint32_t h[5], const uint32_t r[5], const unsigned char* m, size_t blocks);
+}
+#endif
+
 #define mul32x32_64(a,b) ((uint64_t)(a) * (b))
 
 void poly1305_auth(unsigned char out[POLY1305_TAGLEN], const unsigned char *m, size_t inlen, const unsigned char key[POLY1305_KEYLEN]) {
@@ -50,6 +58,20 @@ void poly1305_auth(unsigned char out[POLY1305_TAGLEN], const unsigned char *m, s
     h3 = 0;
     h4 = 0;
 
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL) && defined(HAVE_GETCPUID)
+    /* groups of four full blocks, with one block per lane */
+    static const bool have_avx2{HaveAVX2()};
+    if (have_avx2 && inlen >= 8 * 16) {
+        uint32_t h[5] = {h0, h1, h2, h3, h4};
+        const uint32_t r[5] = {r0, r1, r2, r3, r4};
+        const size_t blocks = inlen / 64 * 4;
+        poly1305_avx2::Blocks_4way(h, r, m, blocks);
+        h0 = h[0]; h1 = h[1]; h2 = h[2]; h3 = h[3]; h4 = h[4];
+        m += blocks * 16;
+        inlen -= blocks * 16;
+    }
+#endif
+
     /* full blocks */
     if (inlen < 16) goto poly1305_donna_atmost15bytes;
 poly1305_donna_16bytes:
@@ -0,0 +1,126 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX2
+
+#include <stddef.h>
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace poly1305_avx2 {
+namespace {
+
+/** a *= b modulo 2^130 - 5, on numbers in radix 2^26. */
+void MulMod(uint32_t a[5], const uint32_t b[5])
+{
+    const uint64_t s1 = b[1] * 5, s2 = b[2] * 5, s3 = b[3] * 5, s4 = b[4] * 5;
+    uint64_t d0 = (uint64_t)a[0] * b[0] + a[1] * s4 + a[2] * s3 + a[3] * s2 + a[4] * s1;
+    uint64_t d1 = (uint64_t)a[0] * b[1] + (uint64_t)a[1] * b[0] + a[2] * s4 + a[3] * s3 + a[4] * s2;
+    uint64_t d2 = (uint64_t)a[0] * b[2] + (uint64_t)a[1] * b[1] + (uint64_t)a[2] * b[0] + a[3] * s4 + a[4] * s3;
+    uint64_t d3 = (uint64_t)a[0] * b[3] + (uint64_t)a[1] * b[2] + (uint64_t)a[2] * b[1] + (uint64_t)a[3] * b[0] + a[4] * s4;
+    uint64_t d4 = (uint64_t)a[0] * b[4] + (uint64_t)a[1] * b[3] + (uint64_t)a[2] * b[2] + (uint64_t)a[3] * b[1] + (uint64_t)a[4] * b[0];
+    d1 += d0 >> 26; a[0] = d0 & 0x3ffffff;
+    d2 += d1 >> 26; a[1] = d1 & 0x3ffffff;
+    d3 += d2 >> 26; a[2] = d2 & 0x3ffffff;
+    d4 += d3 >> 26; a[3] = d3 & 0x3ffffff;
+    uint64_t c = d4 >> 26; a[4] = d4 & 0x3ffffff;
+    c = a[0] + c * 5; a[0] = c & 0x3ffffff;
+    a[1] += c >> 26;
+}
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi64(x, y); }
+__m256i inline Mul(__m256i x, __m256i y) { return _mm256_mul_epu32(x, y); }
+
+/** h = h * r modulo 2^130 - 5 in each 64-bit lane, where s = 5 * r. */
+void inline __attribute__((always_inline)) MulModLanes(__m256i h[5], const __m256i r[5], const __m256i s[5])
+{
+    const __m256i mask = _mm256_set1_epi64x(0x3ffffff);
+    __m256i d0 = Add(Add(Add(Add(Mul(h[0], r[0]), Mul(h[1], s[4])), Mul(h[2], s[3])), Mul(h[3], s[2])), Mul(h[4], s[1]));
+    __m256i d1 = Add(Add(Add(Add(Mul(h[0], r[1]), Mul(h[1], r[0])), Mul(h[2], s[4])), Mul(h[3], s[3])), Mul(h[4], s[2]));
+    __m256i d2 = Add(Add(Add(Add(Mul(h[0], r[2]), Mul(h[1], r[1])), Mul(h[2], r[0])), Mul(h[3], s[4])), Mul(h[4], s[3]));
+    __m256i d3 = Add(Add(Add(Add(Mul(h[0], r[3]), Mul(h[1], r[2])), Mul(h[2], r[1])), Mul(h[3], r[0])), Mul(h[4], s[4]));
+    __m256i d4 = Add(Add(Add(Add(Mul(h[0], r[4]), Mul(h[1], r[3])), Mul(h[2], r[2])), Mul(h[3], r[1])), Mul(h[4], r[0]));
+    d1 = Add(d1, _mm256_srli_epi64(d0, 26)); h[0] = _mm256_and_si256(d0, mask);
+    d2 = Add(d2, _mm256_srli_epi64(d1, 26)); h[1] = _mm256_and_si256(d1, mask);
+    d3 = Add(d3, _mm256_srli_epi64(d2, 26)); h[2] = _mm256_and_si256(d2, mask);
+    d4 = Add(d4, _mm256_srli_epi64(d3, 26)); h[3] = _mm256_and_si256(d3, mask);
+    __m256i c = _mm256_srli_epi64(d4, 26); h[4] = _mm256_and_si256(d4, mask);
+    // h0 + 5 * c, with 5 * c computed as c + 4 * c
+    c = Add(h[0], Add(c, _mm256_slli_epi64(c, 2)));
+    h[0] = _mm256_and_si256(c, mask);
+    h[1] = Add(h[1], _mm256_srli_epi64(c, 26));
+}
+
+/** Add four message blocks, one per lane, in radix 2^26 with the high bit set. */
+void inline __attribute__((always_inline)) AddBlocks(__m256i h[5], const unsigned char* m)
+{
+    const __m256i mask = _mm256_set1_epi64x(0x3ffffff);
+    const __m256i a = _mm256_loadu_si256((const __m256i*)m);
+    const __m256i b = _mm256_loadu_si256((const __m256i*)(m + 32));
+    // Gather the low and high 64 bits of blocks 0, 1, 2 and 3.
+    const __m256i lo = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+    const __m256i hi = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+    h[0] = Add(h[0], _mm256_and_si256(lo, mask));
+    h[1] = Add(h[1], _mm256_and_si256(_mm256_srli_epi64(lo, 26), mask));
+    h[2] = Add(h[2], _mm256_and_si256(_mm256_or_si256(_mm256_srli_epi64(lo, 52), _mm256_slli_epi64(hi, 12)), mask));
+    h[3] = Add(h[3], _mm256_and_si256(_mm256_srli_epi64(hi, 14), mask));
+    h[4] = Add(h[4], _mm256_or_si256(_mm256_srli_epi64(hi, 40), _mm256_set1_epi64x(1 << 24)));
+}
+
+} // namespace
+
+/** Process blocks full 16-byte blocks, a nonzero multiple of four, into the
+ *  accumulator h with key r, both in radix 2^26 as in poly1305_auth.
+ *
+ *  Block i of every four is accumulated in lane i, which is multiplied by r^4
+ *  after each group and by r^(4-i) after the last one, so that the sum of the
+ *  lanes equals the accumulator of processing the blocks one by one.
+ */
+void Blocks_4way(uint32_t h[5], const uint32_t r[5], const unsigned char* m, size_t blocks)
+{
+    uint32_t pow[4][5]; // r^1, r^2, r^3 and r^4
+    for (int i = 0; i < 5; ++i) pow[0][i] = pow[1][i] = r[i];
+    MulMod(pow[1], r);
+    for (int i = 0; i < 5; ++i) pow[2][i] = pow[1][i];
+    MulMod(pow[2], r);
+    for (int i = 0; i < 5; ++i) pow[3][i] = pow[2][i];
+    MulMod(pow[3], r);
+
+    __m256i r4[5], s4[5], rlast[5], slast[5];
+    for (int i = 0; i < 5; ++i) {
+        r4[i] = _mm256_set1_epi64x(pow[3][i]);
+        s4[i] = _mm256_set1_epi64x(pow[3][i] * 5);
+        rlast[i] = _mm256_setr_epi64x(pow[3][i], pow[2][i], pow[1][i], pow[0][i]);
+        slast[i] = _mm256_setr_epi64x(pow[3][i] * 5, pow[2][i] * 5, pow[1][i] * 5, pow[0][i] * 5);
+    }
+
+    // The initial accumulator goes with the first block, in lane 0.
+    __m256i acc[5];
+    for (int i = 0; i < 5; ++i) acc[i] = _mm256_setr_epi64x(h[i], 0, 0, 0);
+
+    for (; blocks > 4; blocks -= 4, m += 64) {
+        AddBlocks(acc, m);
+        MulModLanes(acc, r4, s4);
+    }
+    AddBlocks(acc, m);
+    MulModLanes(acc, rlast, slast);
+
+    // Sum the lanes, each limb of which is below 2^27, and carry.
+    uint64_t d[5];
+    for (int i = 0; i < 5; ++i) {
+        const __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(acc[i]), _mm256_extracti128_si256(acc[i], 1));
+        d[i] = (uint64_t)_mm_cvtsi128_si64(sum) + (uint64_t)_mm_extract_epi64(sum, 1);
+    }
+    d[1] += d[0] >> 26; h[0] = d[0] & 0x3ffffff;
+    d[2] += d[1] >> 26; h[1] = d[1] & 0x3ffffff;
+    d[3] += d[2] >> 26; h[2] = d[2] & 0x3ffffff;
+    d[4] += d[3] >> 26; h[3] = d[3] & 0x3ffffff;
+    const uint64_t c = h[0] + (d[4] >> 26) * 5; h[4] = d[4] & 0x3ffffff;
+    h[0] = c & 0x3ffffff;
+    h[1] += c >> 26;
+}
+
+} // namespace poly1305_avx2
+
+#endif
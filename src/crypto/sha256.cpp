@@ -10,6 +10,17 @@
 
 #include <compat/cpuid.h>
 
+#if defined(ENABLE_ARM_SHANI) && !defined(BUILD_BITCOIN_INTERNAL)
+#if defined(__linux__) && defined(HAVE_STRONG_GETAUXVAL)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+#if defined(MAC_OSX)
+#include <sys/sysctl.h>
+#include <sys/types.h>
+#endif
+#endif
+
 #if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
 #if defined(USE_ASM)
 namespace sha256_sse4
@@ -29,6 +40,21 @@ namespace sha256d64_avx2
 void Transform_8way(unsigned char* out, const unsigned char* in);
 }
 
+namespace sha256_avx2
+{
+void TransformMulti_8way(uint32_t* s, const unsigned char* const* chunks);
+}
+
+namespace sha256d64_avx512
+{
+void Transform_16way(unsigned char* out, const unsigned char* in);
+}
+
+namespace sha256_avx512
+{
+void TransformMulti_16way(uint32_t* s, const unsigned char* const* chunks);
+}
+
 namespace sha256d64_shani
 {
 void Transform_2way(unsigned char* out, const unsigned char* in);
@@ -39,6 +65,16 @@ namespace sha256_shani
 void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
 }
 
+namespace sha256_arm_shani
+{
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
+}
+
+namespace sha256d64_arm_shani
+{
+void Transform_2way(unsigned char* out, const unsigned char* in);
+}
+
 // Internal implementation code.
 namespace
 {
@@ -416,6 +452,8 @@ void TransformD64(unsigned char* out, const unsigned char* in)
 
 typedef void (*TransformType)(uint32_t*, const unsigned char*, size_t);
 typedef void (*TransformD64Type)(unsigned char*, const unsigned char*);
+/** Transform one block for each of several lanes, whose 8-word states are stored one after the other. */
+typedef void (*TransformMultiType)(uint32_t*, const unsigned char* const*);
 
 template<TransformType tr>
 void TransformD64Wrapper(unsigned char* out, const unsigned char* in)
@@ -461,6 +499,9 @@ TransformD64Type TransformD64 = sha256::TransformD64;
 TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
+TransformD64Type TransformD64_16way = nullptr;
+TransformMultiType TransformMulti = nullptr;
+size_t TransformMulti_lanes = 0;
 
 bool SelfTest() {
     // Input state (equal to the initial SHA256 state)
@@ -544,6 +585,31 @@ bool SelfTest() {
         if (!std::equal(out, out + 256, result_d64)) return false;
     }
 
+    // Test TransformD64_16way, if available, on the 8 messages above twice.
+    if (TransformD64_16way) {
+        unsigned char in[1024];
+        std::copy(data + 1, data + 513, in);
+        std::copy(data + 1, data + 513, in + 512);
+        unsigned char out[512];
+        TransformD64_16way(out, in);
+        if (!std::equal(out, out + 256, result_d64)) return false;
+        if (!std::equal(out + 256, out + 512, result_d64)) return false;
+    }
+
+    // Test TransformMulti, if available, with lane i transforming block i % 8 of the input above.
+    if (TransformMulti) {
+        uint32_t states[16 * 8];
+        const unsigned char* chunks[16];
+        for (size_t i = 0; i < TransformMulti_lanes; ++i) {
+            std::copy(result[i % 8], result[i % 8] + 8, states + 8 * i);
+            chunks[i] = data + 1 + 64 * (i % 8);
+        }
+        TransformMulti(states, chunks);
+        for (size_t i = 0; i < TransformMulti_lanes; ++i) {
+            if (!std::equal(states + 8 * i, states + 8 * i + 8, result[i % 8 + 1])) return false;
+        }
+    }
+
     return true;
 }
 
@@ -555,6 +621,14 @@ bool AVXEnabled()
     __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
     return (a & 6) == 6;
 }
+
+/** Check whether the OS has enabled the AVX-512 opmask and ZMM registers, in addition to AVX. */
+bool AVX512Enabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 0xe6) == 0xe6;
+}
 #endif
 } // namespace
 
@@ -567,16 +641,23 @@ std::string SHA256AutoDetect()
     bool have_xsave = false;
     bool have_avx = false;
     bool have_avx2 = false;
+    bool have_avx512 = false;
     bool have_shani = false;
     bool enabled_avx = false;
+    bool enabled_avx512 = false;
+    bool use_shani = false;
 
     (void)AVXEnabled;
+    (void)AVX512Enabled;
     (void)have_sse4;
     (void)have_avx;
     (void)have_xsave;
     (void)have_avx2;
+    (void)have_avx512;
     (void)have_shani;
     (void)enabled_avx;
+    (void)enabled_avx512;
+    (void)use_shani;
 
     uint32_t eax, ebx, ecx, edx;
     GetCPUID(1, 0, eax, ebx, ecx, edx);
@@ -585,10 +666,13 @@ std::string SHA256AutoDetect()
     have_avx = (ecx >> 28) & 1;
     if (have_xsave && have_avx) {
         enabled_avx = AVXEnabled();
+        enabled_avx512 = AVX512Enabled();
     }
     if (have_sse4) {
         GetCPUID(7, 0, eax, ebx, ecx, edx);
         have_avx2 = (ebx >> 5) & 1;
+        // AVX512F and AVX512BW
+        have_avx512 = ((ebx >> 16) & 1) && ((ebx >> 30) & 1);
         have_shani = (ebx >> 29) & 1;
     }
 
@@ -600,6 +684,7 @@ std::string SHA256AutoDetect()
         ret = "shani(1way,2way)";
         have_sse4 = false; // Disable SSE4/AVX2;
         have_avx2 = false;
+        use_shani = true;
     }
 #endif
 
@@ -618,9 +703,47 @@ std::string SHA256AutoDetect()
 #if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
     if (have_avx2 && have_avx && enabled_avx) {
         TransformD64_8way = sha256d64_avx2::Transform_8way;
+        TransformMulti = sha256_avx2::TransformMulti_8way;
+        TransformMulti_lanes = 8;
         ret += ",avx2(8way)";
     }
 #endif
+
+#if defined(ENABLE_AVX512) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx512 && have_avx && enabled_avx512) {
+        TransformD64_16way = sha256d64_avx512::Transform_16way;
+        ret += ",avx512(16way)";
+        // SHA-NI hashes single messages about as fast as this hashes 16 in parallel.
+        if (!use_shani) {
+            TransformMulti = sha256_avx512::TransformMulti_16way;
+            TransformMulti_lanes = 16;
+        }
+    }
+#endif
+#endif
+
+#if defined(USE_ASM) && defined(ENABLE_ARM_SHANI) && !defined(BUILD_BITCOIN_INTERNAL)
+    bool have_arm_shani = false;
+#if defined(__linux__) && defined(HAVE_STRONG_GETAUXVAL)
+#if defined(__aarch64__)
+    have_arm_shani = getauxval(AT_HWCAP) & HWCAP_SHA2;
+#elif defined(__arm__)
+    have_arm_shani = getauxval(AT_HWCAP2) & HWCAP2_SHA2;
+#endif
+#endif
+#if defined(MAC_OSX)
+    int val = 0;
+    size_t len = sizeof(val);
+    if (sysctlbyname("hw.optional.arm.FEAT_SHA256", &val, &len, nullptr, 0) == 0) {
+        have_arm_shani = val != 0;
+    }
+#endif
+    if (have_arm_shani) {
+        Transform = sha256_arm_shani::Transform;
+        TransformD64 = TransformD64Wrapper<sha256_arm_shani::Transform>;
+        TransformD64_2way = sha256d64_arm_shani::Transform_2way;
+        ret = "arm_shani(1way,2way)";
+    }
 #endif
 
     assert(SelfTest());
@@ -686,6 +809,14 @@ CSHA256& CSHA256::Reset()
 
 void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
 {
+    if (TransformD64_16way) {
+        while (blocks >= 16) {
+            TransformD64_16way(out, in);
+            out += 512;
+            in += 1024;
+            blocks -= 16;
+        }
+    }
     if (TransformD64_8way) {
         while (blocks >= 8) {
             TransformD64_8way(out, in);
@@ -717,3 +848,130 @@ void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
         --blocks;
     }
 }
+
+namespace {
+/** The progress of one message through SHA256DMulti. */
+struct MultiLane
+{
+    size_t index;                 //!< Position of the message in the input
+    bool second;                  //!< Whether the outer SHA256 is being computed
+    const unsigned char* data;    //!< Next full block of the message
+    size_t blocks;                //!< Number of full blocks of the message left
+    unsigned char tail[128];      //!< The padded final block(s)
+    size_t tail_blocks;           //!< Number of blocks in tail
+    size_t tail_pos;              //!< Next block in tail
+
+    void Start(size_t i, const unsigned char* in, size_t len, uint32_t* s)
+    {
+        index = i;
+        second = false;
+        data = in;
+        blocks = len / 64;
+        const size_t rem = len % 64;
+        memset(tail, 0, sizeof(tail));
+        memcpy(tail, in + 64 * blocks, rem);
+        tail[rem] = 0x80;
+        tail_blocks = rem < 56 ? 1 : 2;
+        tail_pos = 0;
+        WriteBE64(tail + 64 * tail_blocks - 8, uint64_t{len} << 3);
+        sha256::Initialize(s);
+    }
+
+    const unsigned char* Next()
+    {
+        if (blocks) {
+            --blocks;
+            data += 64;
+            return data - 64;
+        }
+        return tail + 64 * tail_pos++;
+    }
+
+    bool Empty() const { return blocks == 0 && tail_pos == tail_blocks; }
+
+    /** Called once all blocks were transformed. Returns whether the message is done. */
+    bool Finish(uint32_t* s, unsigned char* output)
+    {
+        unsigned char* out = second ? output + 32 * index : tail;
+        for (int i = 0; i < 8; ++i) {
+            WriteBE32(out + 4 * i, s[i]);
+        }
+        if (second) return true;
+
+        // Set up the outer SHA256 over the 32-byte inner hash, which is already in tail.
+        static const unsigned char padding[32] = {0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                                  0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0};
+        memcpy(tail + 32, padding, 32);
+        second = true;
+        tail_blocks = 1;
+        tail_pos = 0;
+        sha256::Initialize(s);
+        return false;
+    }
+};
+} // namespace
+
+size_t SHA256DMultiLanes()
+{
+    return TransformMulti ? TransformMulti_lanes : 0;
+}
+
+void SHA256DMulti(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count)
+{
+    if (!TransformMulti) {
+        for (size_t i = 0; i < count; ++i) {
+            unsigned char inner[CSHA256::OUTPUT_SIZE];
+            CSHA256().Write(inputs[i], lengths[i]).Finalize(inner);
+            CSHA256().Write(inner, sizeof(inner)).Finalize(output + 32 * i);
+        }
+        return;
+    }
+
+    static const unsigned char idle_block[64] = {0};
+    const size_t width = TransformMulti_lanes;
+    MultiLane lanes[16];
+    uint32_t states[16 * 8];
+    bool active[16] = {false};
+    size_t num_active = 0;
+    size_t next = 0;
+
+    while (true) {
+        // Assign the next messages to idle lanes.
+        for (size_t l = 0; l < width && next < count; ++l) {
+            if (active[l]) continue;
+            lanes[l].Start(next, inputs[next], lengths[next], states + 8 * l);
+            ++next;
+            active[l] = true;
+            ++num_active;
+        }
+        // Once too few messages are left to fill the lanes, finishing them one
+        // by one is faster than transforming mostly idle lanes.
+        if (next == count && num_active <= width / 2) break;
+
+        const unsigned char* chunks[16];
+        for (size_t l = 0; l < width; ++l) {
+            chunks[l] = active[l] ? lanes[l].Next() : idle_block;
+        }
+        TransformMulti(states, chunks);
+        for (size_t l = 0; l < width; ++l) {
+            if (active[l] && lanes[l].Empty() && lanes[l].Finish(states + 8 * l, output)) {
+                active[l] = false;
+                --num_active;
+            }
+        }
+    }
+
+    // Finish the remaining lanes.
+    for (size_t l = 0; l < width; ++l) {
+        if (!active[l]) continue;
+        uint32_t* s = states + 8 * l;
+        do {
+            if (lanes[l].blocks) {
+                Transform(s, lanes[l].data, lanes[l].blocks);
+                lanes[l].data += 64 * lanes[l].blocks;
+                lanes[l].blocks = 0;
+            }
+            while (!lanes[l].Empty()) Transform(s, lanes[l].Next(), 1);
+        } while (!lanes[l].Finish(s, output));
+    }
+}
@@ -38,4 +38,18 @@ std::string SHA256AutoDetect();
  */
 void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
 
+/** Compute the double-SHA256's of multiple messages of arbitrary length,
+ *  hashing several of them in parallel SIMD lanes where available.
+ *  output:  pointer to a count*32 byte output buffer
+ *  inputs:  pointers to the count messages
+ *  lengths: the lengths of the count messages
+ *  count:   the number of hashes to compute.
+ */
+void SHA256DMulti(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count);
+
+/** The number of messages SHA256DMulti() hashes in parallel, or 0 if it
+ *  hashes them one after the other (no multi-lane implementation available).
+ */
+size_t SHA256DMultiLanes();
+
 #endif // BITCOIN_CRYPTO_SHA256_H
@@ -0,0 +1,144 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_ARM_SHANI
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <arm_neon.h>
+
+namespace {
+alignas(uint32x4_t) static constexpr std::array<uint32_t, 64> K =
+{
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+    0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+    0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+    0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+    0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+    0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+    0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+alignas(uint32x4_t) static constexpr std::array<uint32_t, 8> INIT =
+{
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+    0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+};
+
+/** Four rounds of SHA-256, extending the message schedule by four words if schedule is set. */
+template <int i, bool schedule>
+void inline __attribute__((always_inline)) QuadRound(uint32x4_t& abcd, uint32x4_t& efgh, uint32x4_t& m0, uint32x4_t m1, uint32x4_t m2, uint32x4_t m3)
+{
+    const uint32x4_t tmp = vaddq_u32(m0, vld1q_u32(&K[4 * i]));
+    if (schedule) m0 = vsha256su1q_u32(vsha256su0q_u32(m0, m1), m2, m3);
+    const uint32x4_t abcd_prev = abcd;
+    abcd = vsha256hq_u32(abcd, efgh, tmp);
+    efgh = vsha256h2q_u32(efgh, abcd_prev, tmp);
+}
+
+/** Compress one block, given as sixteen message words in m0..m3, into the state abcd/efgh. */
+void inline __attribute__((always_inline)) Compress(uint32x4_t& abcd, uint32x4_t& efgh, uint32x4_t m0, uint32x4_t m1, uint32x4_t m2, uint32x4_t m3)
+{
+    const uint32x4_t abcd_save = abcd;
+    const uint32x4_t efgh_save = efgh;
+
+    QuadRound<0, true>(abcd, efgh, m0, m1, m2, m3);
+    QuadRound<1, true>(abcd, efgh, m1, m2, m3, m0);
+    QuadRound<2, true>(abcd, efgh, m2, m3, m0, m1);
+    QuadRound<3, true>(abcd, efgh, m3, m0, m1, m2);
+    QuadRound<4, true>(abcd, efgh, m0, m1, m2, m3);
+    QuadRound<5, true>(abcd, efgh, m1, m2, m3, m0);
+    QuadRound<6, true>(abcd, efgh, m2, m3, m0, m1);
+    QuadRound<7, true>(abcd, efgh, m3, m0, m1, m2);
+    QuadRound<8, true>(abcd, efgh, m0, m1, m2, m3);
+    QuadRound<9, true>(abcd, efgh, m1, m2, m3, m0);
+    QuadRound<10, true>(abcd, efgh, m2, m3, m0, m1);
+    QuadRound<11, true>(abcd, efgh, m3, m0, m1, m2);
+    QuadRound<12, false>(abcd, efgh, m0, m1, m2, m3);
+    QuadRound<13, false>(abcd, efgh, m1, m2, m3, m0);
+    QuadRound<14, false>(abcd, efgh, m2, m3, m0, m1);
+    QuadRound<15, false>(abcd, efgh, m3, m0, m1, m2);
+
+    abcd = vaddq_u32(abcd, abcd_save);
+    efgh = vaddq_u32(efgh, efgh_save);
+}
+
+/** Load four big endian message words. */
+uint32x4_t inline Load(const unsigned char* chunk)
+{
+    return vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(chunk)));
+}
+
+/** Store four state words big endian. */
+void inline Store(unsigned char* out, uint32x4_t v)
+{
+    vst1q_u8(out, vrev32q_u8(vreinterpretq_u8_u32(v)));
+}
+}
+
+namespace sha256_arm_shani {
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    uint32x4_t abcd = vld1q_u32(&s[0]);
+    uint32x4_t efgh = vld1q_u32(&s[4]);
+
+    while (blocks--) {
+        Compress(abcd, efgh, Load(chunk), Load(chunk + 16), Load(chunk + 32), Load(chunk + 48));
+        chunk += 64;
+    }
+
+    vst1q_u32(&s[0], abcd);
+    vst1q_u32(&s[4], efgh);
+}
+}
+
+namespace sha256d64_arm_shani {
+void Transform_2way(unsigned char* out, const unsigned char* in)
+{
+    // Padding of the 64-byte input, and of the 32-byte intermediate hash.
+    alignas(uint32x4_t) static constexpr std::array<uint32_t, 4> PAD_HIGH = {0x80000000, 0, 0, 0};
+    alignas(uint32x4_t) static constexpr std::array<uint32_t, 4> PAD_LEN64 = {0, 0, 0, 0x200};
+    alignas(uint32x4_t) static constexpr std::array<uint32_t, 4> PAD_LEN32 = {0, 0, 0, 0x100};
+    const uint32x4_t pad_high = vld1q_u32(PAD_HIGH.data());
+    const uint32x4_t zero = vdupq_n_u32(0);
+
+    // Both messages are processed in the same function so that the two
+    // independent dependency chains keep the SHA-256 unit busy.
+    uint32x4_t abcd_a = vld1q_u32(&INIT[0]), efgh_a = vld1q_u32(&INIT[4]);
+    uint32x4_t abcd_b = abcd_a, efgh_b = efgh_a;
+
+    // Transform 1: the input block.
+    Compress(abcd_a, efgh_a, Load(in), Load(in + 16), Load(in + 32), Load(in + 48));
+    Compress(abcd_b, efgh_b, Load(in + 64), Load(in + 80), Load(in + 96), Load(in + 112));
+
+    // Transform 2: the padding block of the first SHA-256.
+    const uint32x4_t len64 = vld1q_u32(PAD_LEN64.data());
+    Compress(abcd_a, efgh_a, pad_high, zero, zero, len64);
+    Compress(abcd_b, efgh_b, pad_high, zero, zero, len64);
+
+    // Transform 3: the second SHA-256 of the resulting 32-byte hash.
+    const uint32x4_t len32 = vld1q_u32(PAD_LEN32.data());
+    uint32x4_t abcd2_a = vld1q_u32(&INIT[0]), efgh2_a = vld1q_u32(&INIT[4]);
+    uint32x4_t abcd2_b = abcd2_a, efgh2_b = efgh2_a;
+    Compress(abcd2_a, efgh2_a, abcd_a, efgh_a, pad_high, len32);
+    Compress(abcd2_b, efgh2_b, abcd_b, efgh_b, pad_high, len32);
+
+    Store(out, abcd2_a);
+    Store(out + 16, efgh2_a);
+    Store(out + 32, abcd2_b);
+    Store(out + 48, efgh2_b);
+}
+}
+
+#endif
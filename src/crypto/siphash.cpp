@@ -4,6 +4,20 @@
 
 #include <crypto/siphash.h>
 
+#include <crypto/common.h>
+#include <compat/cpuid.h>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+namespace siphash_avx2
+{
+void SipHashUint256_4way(uint64_t k0, uint64_t k1, const uint256* vals, uint64_t* out);
+}
+#endif
+
 #define ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
 
 #define SIPROUND do { \
@@ -171,3 +185,76 @@ uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint3
     SIPROUND;
     return v0 ^ v1 ^ v2 ^ v3;
 }
+
+namespace {
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+/** SipHashUint256 of two values at once, one per NEON lane. */
+template <int b> uint64x2_t inline RotL(uint64x2_t x) { return vsriq_n_u64(vshlq_n_u64(x, b), x, 64 - b); }
+template <> uint64x2_t inline RotL<32>(uint64x2_t x) { return vreinterpretq_u64_u32(vrev64q_u32(vreinterpretq_u32_u64(x))); }
+
+void inline SipRound(uint64x2_t& v0, uint64x2_t& v1, uint64x2_t& v2, uint64x2_t& v3)
+{
+    v0 = vaddq_u64(v0, v1); v1 = RotL<13>(v1); v1 = veorq_u64(v1, v0);
+    v0 = RotL<32>(v0);
+    v2 = vaddq_u64(v2, v3); v3 = RotL<16>(v3); v3 = veorq_u64(v3, v2);
+    v0 = vaddq_u64(v0, v3); v3 = RotL<21>(v3); v3 = veorq_u64(v3, v0);
+    v2 = vaddq_u64(v2, v1); v1 = RotL<17>(v1); v1 = veorq_u64(v1, v2);
+    v2 = RotL<32>(v2);
+}
+
+void inline Compress(uint64x2_t& v0, uint64x2_t& v1, uint64x2_t& v2, uint64x2_t& v3, uint64x2_t d)
+{
+    v3 = veorq_u64(v3, d);
+    SipRound(v0, v1, v2, v3);
+    SipRound(v0, v1, v2, v3);
+    v0 = veorq_u64(v0, d);
+}
+
+void SipHashUint256_2way(uint64_t k0, uint64_t k1, const uint256* vals, uint64_t* out)
+{
+    const uint64x2_t a01 = vld1q_u64((const uint64_t*)vals[0].begin());
+    const uint64x2_t a23 = vld1q_u64((const uint64_t*)vals[0].begin() + 2);
+    const uint64x2_t b01 = vld1q_u64((const uint64_t*)vals[1].begin());
+    const uint64x2_t b23 = vld1q_u64((const uint64_t*)vals[1].begin() + 2);
+
+    uint64x2_t v0 = vdupq_n_u64(0x736f6d6570736575ULL ^ k0);
+    uint64x2_t v1 = vdupq_n_u64(0x646f72616e646f6dULL ^ k1);
+    uint64x2_t v2 = vdupq_n_u64(0x6c7967656e657261ULL ^ k0);
+    uint64x2_t v3 = vdupq_n_u64(0x7465646279746573ULL ^ k1);
+
+    Compress(v0, v1, v2, v3, vzip1q_u64(a01, b01));
+    Compress(v0, v1, v2, v3, vzip2q_u64(a01, b01));
+    Compress(v0, v1, v2, v3, vzip1q_u64(a23, b23));
+    Compress(v0, v1, v2, v3, vzip2q_u64(a23, b23));
+    Compress(v0, v1, v2, v3, vdupq_n_u64(((uint64_t)4) << 59));
+    v2 = veorq_u64(v2, vdupq_n_u64(0xFF));
+    SipRound(v0, v1, v2, v3);
+    SipRound(v0, v1, v2, v3);
+    SipRound(v0, v1, v2, v3);
+    SipRound(v0, v1, v2, v3);
+    vst1q_u64(out, veorq_u64(veorq_u64(v0, v1), veorq_u64(v2, v3)));
+}
+#endif
+
+} // namespace
+
+void SipHashUint256Batch(uint64_t k0, uint64_t k1, const uint256* vals, size_t count, uint64_t* out)
+{
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL) && defined(HAVE_GETCPUID)
+    static const bool have_avx2{HaveAVX2()};
+    if (have_avx2) {
+        for (; count >= 4; count -= 4, vals += 4, out += 4) {
+            siphash_avx2::SipHashUint256_4way(k0, k1, vals, out);
+        }
+    }
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+    for (; count >= 2; count -= 2, vals += 2, out += 2) {
+        SipHashUint256_2way(k0, k1, vals, out);
+    }
+#endif
+    for (; count > 0; --count, ++vals, ++out) {
+        *out = SipHashUint256(k0, k1, *vals);
+    }
+}
@@ -44,4 +44,9 @@ public:
 uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const uint256& val);
 uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint32_t extra);
 
+/** Compute SipHashUint256(k0, k1, vals[i]) into out[i] for count values,
+ *  hashing several of them in parallel SIMD lanes where available.
+ */
+void SipHashUint256Batch(uint64_t k0, uint64_t k1, const uint256* vals, size_t count, uint64_t* out);
+
 #endif // BITCOIN_CRYPTO_SIPHASH_H
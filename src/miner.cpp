@@ -435,7 +435,7 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
     }
 }
 
-void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
+void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce, IncrementalMerkleTree* merkle_tree)
 {
     // Update nExtraNonce
     static uint256 hashPrevBlock;
@@ -451,5 +451,17 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
     assert(txCoinbase.vin[0].scriptSig.size() <= 100);
 
     pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
-    pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
+    if (!merkle_tree) {
+        pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
+    } else if (merkle_tree->Size() == 0) {
+        std::vector<uint256> leaves;
+        leaves.reserve(pblock->vtx.size());
+        for (const CTransactionRef& tx : pblock->vtx) leaves.push_back(tx->GetHash());
+        *merkle_tree = IncrementalMerkleTree(std::move(leaves));
+        pblock->hashMerkleRoot = merkle_tree->Root();
+    } else {
+        assert(merkle_tree->Size() == pblock->vtx.size());
+        merkle_tree->Update(0, pblock->vtx[0]->GetHash());
+        pblock->hashMerkleRoot = merkle_tree->Root();
+    }
 }
@@ -20,6 +20,7 @@
 class CBlockIndex;
 class CChainParams;
 class CScript;
+class IncrementalMerkleTree;
 
 namespace Consensus { struct Params; };
 
@@ -197,8 +198,11 @@ private:
     int UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded, indexed_modified_transaction_set& mapModifiedTx) EXCLUSIVE_LOCKS_REQUIRED(m_mempool.cs);
 };
 
-/** Modify the extranonce in a block */
-void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
+/** Modify the extranonce in a block. If merkle_tree is given, it is built
+ *  over the transactions of the block when empty, and otherwise must hold
+ *  them from a previous call: only the coinbase is updated in it, so rolling
+ *  the extranonce again costs O(log n) hashes instead of O(n). */
+void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce, IncrementalMerkleTree* merkle_tree = nullptr);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
 
 /** Update an old GenerateCoinbaseCommitment from CreateNewBlock after the block txs have changed */
@@ -31,7 +31,9 @@
 #include <util/system.h>
 #include <validation.h>
 
+#include <algorithm>
 #include <memory>
+#include <unordered_set>
 #include <typeinfo>
 
 /** Expiration time for orphan transactions in seconds */
@@ -90,8 +92,15 @@ static constexpr auto OVERLOADED_PEER_TX_DELAY = std::chrono::seconds{2};
 static constexpr std::chrono::microseconds GETDATA_TX_INTERVAL{std::chrono::seconds{60}};
 /** Limit to avoid sending big packets. Not used in processing incoming GETDATA for compatibility */
 static const unsigned int MAX_GETDATA_SZ = 1000;
-/** Number of blocks that can be requested at any given time from a single peer. */
+/** Number of blocks that can be requested at any given time from a single peer when fetching
+ *  blocks near the tip directly, or in parallel download until its block delivery rate has been measured. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
+/** Bounds on the adaptive number of blocks in flight from a single peer whose delivery rate is known. */
+static constexpr int MIN_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER = 2;
+static constexpr int MAX_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER = 64;
+/** A peer is assigned roughly as many blocks as it can deliver within this time at its measured
+ *  rate, so that slow peers don't hold on to large parts of the block download window. */
+static constexpr std::chrono::seconds BLOCK_DOWNLOAD_QUEUE_TIME{2};
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
 static const unsigned int BLOCK_STALLING_TIMEOUT = 2;
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
@@ -129,6 +138,11 @@ static const unsigned int INVENTORY_BROADCAST_INTERVAL = 5;
 static constexpr unsigned int INVENTORY_BROADCAST_PER_SECOND = 7;
 /** Maximum number of inventory items to send per transmission. */
 static constexpr unsigned int INVENTORY_BROADCAST_MAX = INVENTORY_BROADCAST_PER_SECOND * INVENTORY_BROADCAST_INTERVAL;
+/** Maximum number of transactions in the shared announcement batch (g_tx_relay_batch). */
+static constexpr size_t MAX_TX_RELAY_BATCH_SIZE = 100000;
+/** How long a queued transaction stays in the shared announcement batch. Peers
+ *  that haven't announced it by then fall back to sorting it themselves. */
+static constexpr std::chrono::seconds TX_RELAY_BATCH_EXPIRY{30};
 /** The number of most recently announced transactions a peer can request. */
 static constexpr unsigned int INVENTORY_MAX_RECENT_RELAY = 3500;
 /** Verify that INVENTORY_MAX_RECENT_RELAY is enough to cache everything typically
@@ -224,12 +238,44 @@ namespace {
     Mutex g_cs_recent_confirmed_transactions;
     std::unique_ptr<CRollingBloomFilter> g_recent_confirmed_transactions GUARDED_BY(g_cs_recent_confirmed_transactions);
 
+    /** A transaction queued for announcement by RelayTransaction(). */
+    struct TxRelayQueued {
+        uint256 txid;
+        uint256 wtxid;
+        std::chrono::microseconds time;
+    };
+
+    /**
+     * The recently queued transactions, sorted in announcement order. Shared
+     * by all peers: the keys are looked up and sorted once whenever the batch
+     * changes, and each peer then announces the entries of its inventory set
+     * in batch order, without sorting anything itself.
+     */
+    struct TxRelayBatch {
+        struct Entry {
+            TxRelayOrderKey key;
+            uint256 wtxid;
+            std::chrono::microseconds time;
+        };
+        std::vector<Entry> entries;
+        /** Txids and wtxids of all entries. */
+        std::unordered_set<uint256, SaltedTxidHasher> hashes;
+        /** CTxMemPool::GetRelayOrderEpoch() the keys were looked up at. */
+        uint64_t epoch;
+    };
+
+    Mutex g_cs_tx_relay_batch;
+    std::shared_ptr<const TxRelayBatch> g_tx_relay_batch GUARDED_BY(g_cs_tx_relay_batch);
+    /** Transactions queued since g_tx_relay_batch was built. */
+    std::vector<TxRelayQueued> g_tx_relay_queued GUARDED_BY(g_cs_tx_relay_batch);
+
     /** Blocks that are in flight, and that are in the queue to be downloaded. */
     struct QueuedBlock {
         uint256 hash;
         const CBlockIndex* pindex;                               //!< Optional.
         bool fValidatedHeaders;                                  //!< Whether this block has validated headers at the time of request.
         std::unique_ptr<PartiallyDownloadedBlock> partialBlock;  //!< Optional, used for CMPCTBLOCK downloads
+        int64_t m_time_requested;                                //!< When the block was requested (in microseconds), or 0 if it was sent unrequested.
     };
     std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> > mapBlocksInFlight GUARDED_BY(cs_main);
 
@@ -311,6 +357,12 @@ struct CNodeState {
     int64_t nDownloadingSince;
     int nBlocksInFlight;
     int nBlocksInFlightValidHeaders;
+    //! Moving average of the time (in microseconds) this peer takes to deliver one requested block, or 0 if unknown.
+    int64_t m_block_delivery_time{0};
+    //! When this peer last delivered a block we requested from it (in microseconds).
+    int64_t m_last_block_delivery{0};
+    //! How many blocks we are willing to have in flight from this peer, see UpdateBlocksInFlightTarget().
+    int m_blocks_in_flight_target{MAX_BLOCKS_IN_TRANSIT_PER_PEER};
     //! Whether we consider this a preferred download peer.
     bool fPreferredDownload;
     //! Whether this peer wants invs or headers (when possible) for block announcements.
@@ -409,6 +461,36 @@ struct CNodeState {
     }
 };
 
+/** Scoped timer that adds the time the message handler thread spends on a peer to its m_msg_time_stats. */
+class PeerMsgTimer
+{
+    const PeerRef m_peer;
+    const std::string* const m_msg_type;
+    const std::chrono::steady_clock::time_point m_start{std::chrono::steady_clock::now()};
+
+public:
+    /** Time processing a message of type msg_type, or SendMessages if msg_type is nullptr. */
+    PeerMsgTimer(PeerRef peer, const std::string* msg_type) : m_peer(std::move(peer)), m_msg_type(msg_type) {}
+
+    ~PeerMsgTimer()
+    {
+        if (m_peer == nullptr) return;
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start);
+        LOCK(m_peer->m_msg_time_stats_mutex);
+        PeerMsgTimeStats& stats = m_peer->m_msg_time_stats;
+        if (m_msg_type == nullptr) {
+            stats.m_send_messages.Add(elapsed);
+            return;
+        }
+        auto it = stats.m_process_message.find(*m_msg_type);
+        if (it == stats.m_process_message.end()) {
+            it = stats.m_process_message.find(NET_MESSAGE_COMMAND_OTHER);
+        }
+        assert(it != stats.m_process_message.end());
+        it->second.Add(elapsed);
+    }
+};
+
 /** Map maintaining per-node state. */
 static std::map<NodeId, CNodeState> mapNodeState GUARDED_BY(cs_main);
 
@@ -431,11 +513,24 @@ static void UpdatePreferredDownload(const CNode& node, CNodeState* state) EXCLUS
 
 // Returns a bool indicating whether we requested this block.
 // Also used if a block was /not/ received and timed out or started with another peer
-static bool MarkBlockAsReceived(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+// If from is the peer we requested the block from, the delivery updates that peer's download rate estimate.
+static bool MarkBlockAsReceived(const uint256& hash, NodeId from = -1) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
     std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(hash);
     if (itInFlight != mapBlocksInFlight.end()) {
         CNodeState *state = State(itInFlight->second.first);
         assert(state != nullptr);
+        const int64_t now = count_microseconds(GetTime<std::chrono::microseconds>());
+        if (itInFlight->second.first == from && itInFlight->second.second->m_time_requested != 0) {
+            // The peer was busy with this block since it delivered the previous one, or since
+            // we asked for it, whichever came last.
+            const int64_t delivery_time = now - std::max(state->m_last_block_delivery, itInFlight->second.second->m_time_requested);
+            if (state->m_block_delivery_time == 0) {
+                state->m_block_delivery_time = delivery_time;
+            } else {
+                state->m_block_delivery_time = (7 * state->m_block_delivery_time + delivery_time) / 8;
+            }
+            state->m_last_block_delivery = now;
+        }
         state->nBlocksInFlightValidHeaders -= itInFlight->second.second->fValidatedHeaders;
         if (state->nBlocksInFlightValidHeaders == 0 && itInFlight->second.second->fValidatedHeaders) {
             // Last validated block on the queue was received.
@@ -443,7 +538,7 @@ static bool MarkBlockAsReceived(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs
         }
         if (state->vBlocksInFlight.begin() == itInFlight->second.second) {
             // First block on the queue was received, update the start download time for the next one
-            state->nDownloadingSince = std::max(state->nDownloadingSince, count_microseconds(GetTime<std::chrono::microseconds>()));
+            state->nDownloadingSince = std::max(state->nDownloadingSince, now);
         }
         state->vBlocksInFlight.erase(itInFlight->second.second);
         state->nBlocksInFlight--;
@@ -472,13 +567,14 @@ static bool MarkBlockAsInFlight(CTxMemPool& mempool, NodeId nodeid, const uint25
     // Make sure it's not listed somewhere already.
     MarkBlockAsReceived(hash);
 
+    const int64_t now = count_microseconds(GetTime<std::chrono::microseconds>());
     std::list<QueuedBlock>::iterator it = state->vBlocksInFlight.insert(state->vBlocksInFlight.end(),
-            {hash, pindex, pindex != nullptr, std::unique_ptr<PartiallyDownloadedBlock>(pit ? new PartiallyDownloadedBlock(&mempool) : nullptr)});
+            {hash, pindex, pindex != nullptr, std::unique_ptr<PartiallyDownloadedBlock>(pit ? new PartiallyDownloadedBlock(&mempool) : nullptr), now});
     state->nBlocksInFlight++;
     state->nBlocksInFlightValidHeaders += it->fValidatedHeaders;
     if (state->nBlocksInFlight == 1) {
         // We're starting a block download (batch) from this peer.
-        state->nDownloadingSince = GetTime<std::chrono::microseconds>().count();
+        state->nDownloadingSince = now;
     }
     if (state->nBlocksInFlightValidHeaders == 1 && pindex != nullptr) {
         nPeersWithValidatedDownloads++;
@@ -489,6 +585,25 @@ static bool MarkBlockAsInFlight(CTxMemPool& mempool, NodeId nodeid, const uint25
     return true;
 }
 
+/**
+ * Recompute how many blocks we want in flight from a peer. Peers whose delivery rate is known get
+ * enough blocks to stay busy for BLOCK_DOWNLOAD_QUEUE_TIME, and at least enough to cover twice
+ * their round trip time, so that fast peers saturate their bandwidth while slow ones only hold a
+ * few blocks of the download window. Peers that haven't delivered a block yet (or whose ping is
+ * unknown) get the static MAX_BLOCKS_IN_TRANSIT_PER_PEER.
+ */
+static void UpdateBlocksInFlightTarget(CNodeState& state, int64_t min_ping_usec) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    if (state.m_block_delivery_time <= 0 || min_ping_usec == std::numeric_limits<int64_t>::max()) {
+        state.m_blocks_in_flight_target = MAX_BLOCKS_IN_TRANSIT_PER_PEER;
+        return;
+    }
+    const int64_t queue_target = count_microseconds(BLOCK_DOWNLOAD_QUEUE_TIME) / state.m_block_delivery_time;
+    const int64_t latency_target = 2 * min_ping_usec / state.m_block_delivery_time + 1;
+    state.m_blocks_in_flight_target = std::clamp<int64_t>(std::max(queue_target, latency_target),
+                                                          MIN_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER, MAX_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER);
+}
+
 /** Check whether the last unknown block a peer advertised is not yet known. */
 static void ProcessBlockAvailability(NodeId nodeid) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
     CNodeState *state = State(nodeid);
@@ -745,6 +860,15 @@ void UpdateLastBlockAnnounceTime(NodeId node, int64_t time_in_seconds)
     if (state) state->m_last_block_announcement = time_in_seconds;
 }
 
+// This function is used for testing the block download rate estimate, see
+// denialofservice_tests.cpp
+int64_t GetBlockDeliveryTime(NodeId node)
+{
+    LOCK(cs_main);
+    CNodeState *state = State(node);
+    return state ? state->m_block_delivery_time : 0;
+}
+
 void PeerManager::InitializeNode(CNode *pnode) {
     CAddress addr = pnode->addr;
     std::string addrName = pnode->GetAddrName();
@@ -853,6 +977,26 @@ PeerRef PeerManager::RemovePeer(NodeId id)
     return ret;
 }
 
+void MsgProcessingTime::Add(std::chrono::microseconds elapsed)
+{
+    ++m_count;
+    m_total += elapsed;
+    m_max = std::max(m_max, elapsed);
+    size_t bucket = 0;
+    for (uint64_t t = elapsed.count(); t > 0 && bucket + 1 < HISTOGRAM_BUCKETS; t >>= 1) {
+        ++bucket;
+    }
+    ++m_histogram[bucket];
+}
+
+bool PeerManager::GetPeerMsgTimeStats(NodeId nodeid, PeerMsgTimeStats& stats) const
+{
+    PeerRef peer = GetPeerRef(nodeid);
+    if (peer == nullptr) return false;
+    stats = WITH_LOCK(peer->m_msg_time_stats_mutex, return peer->m_msg_time_stats);
+    return true;
+}
+
 bool PeerManager::GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
     {
         LOCK(cs_main);
@@ -1397,7 +1541,8 @@ bool static AlreadyHaveBlock(const uint256& block_hash) EXCLUSIVE_LOCKS_REQUIRED
 
 void RelayTransaction(const uint256& txid, const uint256& wtxid, const CConnman& connman)
 {
-    connman.ForEachNode([&txid, &wtxid](CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
+    bool queued{false};
+    connman.ForEachNode([&txid, &wtxid, &queued](CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
         AssertLockHeld(::cs_main);
 
         CNodeState* state = State(pnode->GetId());
@@ -1407,7 +1552,14 @@ void RelayTransaction(const uint256& txid, const uint256& wtxid, const CConnman&
         } else {
             pnode->PushTxInventory(txid);
         }
+        queued |= pnode->m_tx_relay != nullptr;
     });
+    if (!queued) return;
+
+    LOCK(g_cs_tx_relay_batch);
+    if (g_tx_relay_queued.size() < MAX_TX_RELAY_BATCH_SIZE) {
+        g_tx_relay_queued.push_back({txid, wtxid, GetTime<std::chrono::microseconds>()});
+    }
 }
 
 /**
@@ -3264,6 +3416,10 @@ void PeerManager::ProcessMessage(CNode& pfrom, const std::string& msg_type, CDat
                         req.indexes.push_back(i);
                 }
                 if (req.indexes.empty()) {
+                    if (!fAlreadyInFlight) {
+                        // Nothing was asked of the peer, so this says nothing about its download rate
+                        (*queuedBlockIt)->m_time_requested = 0;
+                    }
                     // Dirty hack to jump to BLOCKTXN code (TODO: move message handling into their own functions)
                     BlockTransactions txn;
                     txn.blockhash = cmpctblock.header.GetHash();
@@ -3407,7 +3563,7 @@ void PeerManager::ProcessMessage(CNode& pfrom, const std::string& msg_type, CDat
                 // though the block was successfully read, and rely on the
                 // handling in ProcessNewBlock to ensure the block index is
                 // updated, etc.
-                MarkBlockAsReceived(resp.blockhash); // it is now an empty pointer
+                MarkBlockAsReceived(resp.blockhash, pfrom.GetId()); // it is now an empty pointer
                 fBlockRead = true;
                 // mapBlockSource is used for potentially punishing peers and
                 // updating which peers send us compact blocks, so the race
@@ -3481,7 +3637,7 @@ void PeerManager::ProcessMessage(CNode& pfrom, const std::string& msg_type, CDat
             LOCK(cs_main);
             // Also always process if we requested the block explicitly, as we may
             // need it even though it is not a candidate for a new best tip.
-            forceProcessing |= MarkBlockAsReceived(hash);
+            forceProcessing |= MarkBlockAsReceived(hash, pfrom.GetId());
             // mapBlockSource is only used for punishing peers and setting
             // which peers send us compact blocks, so the race between here and
             // cs_main in ProcessNewBlock is fine.
@@ -3849,6 +4005,7 @@ bool PeerManager::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgP
     unsigned int nMessageSize = msg.m_message_size;
 
     try {
+        PeerMsgTimer timer{peer, &msg_type};
         ProcessMessage(*pfrom, msg_type, msg.m_recv, msg.m_time, interruptMsgProc);
         if (interruptMsgProc) return false;
         {
@@ -4045,29 +4202,81 @@ void PeerManager::CheckForStaleTipAndEvictPeers()
 }
 
 namespace {
-class CompareInvMempoolOrder
+using InvTxCandidate = std::pair<TxRelayOrderKey, std::set<uint256>::iterator>;
+
+/**
+ * The shared announcement batch, brought up to date with the transactions
+ * queued since it was built. If the mempool's relay order epoch moved on, all
+ * keys are looked up again, and transactions that left the mempool are dropped.
+ */
+std::shared_ptr<const TxRelayBatch> GetTxRelayBatch(const CTxMemPool& mempool, std::chrono::microseconds now) LOCKS_EXCLUDED(g_cs_tx_relay_batch)
 {
-    CTxMemPool *mp;
-    bool m_wtxid_relay;
-public:
-    explicit CompareInvMempoolOrder(CTxMemPool *_mempool, bool use_wtxid)
+    std::shared_ptr<const TxRelayBatch> batch;
+    std::vector<TxRelayQueued> lookup;
     {
-        mp = _mempool;
-        m_wtxid_relay = use_wtxid;
+        LOCK(g_cs_tx_relay_batch);
+        batch = g_tx_relay_batch;
+        if (batch && g_tx_relay_queued.empty() && batch->epoch == mempool.GetRelayOrderEpoch()) return batch;
+        lookup.swap(g_tx_relay_queued);
+    }
+    // Only the message handler thread rebuilds the batch, so it can be done
+    // without holding g_cs_tx_relay_batch.
+    const bool refresh = !batch || batch->epoch != mempool.GetRelayOrderEpoch();
+
+    auto new_batch = std::make_shared<TxRelayBatch>();
+    if (batch) {
+        std::unordered_set<uint256, SaltedTxidHasher> requeued;
+        for (const TxRelayQueued& queued : lookup) requeued.insert(queued.txid);
+        for (const TxRelayBatch::Entry& entry : batch->entries) {
+            if (entry.time + TX_RELAY_BATCH_EXPIRY < now || requeued.count(entry.key.m_txid)) continue;
+            if (refresh) {
+                lookup.push_back({entry.key.m_txid, entry.wtxid, entry.time});
+            } else {
+                new_batch->entries.push_back(entry);
+            }
+        }
+    }
+    if (new_batch->entries.size() + lookup.size() > MAX_TX_RELAY_BATCH_SIZE) {
+        // Whatever doesn't fit is sorted per peer.
+        lookup.resize(MAX_TX_RELAY_BATCH_SIZE - new_batch->entries.size());
     }
 
-    bool operator()(std::set<uint256>::iterator a, std::set<uint256>::iterator b)
-    {
-        /* As std::make_heap produces a max-heap, we want the entries with the
-         * fewest ancestors/highest fee to sort later. */
-        return mp->CompareDepthAndScore(*b, *a, m_wtxid_relay);
+    std::vector<uint256> txids;
+    txids.reserve(lookup.size());
+    for (const TxRelayQueued& queued : lookup) txids.push_back(queued.txid);
+    uint64_t epoch;
+    const auto keys = mempool.GetRelayOrderKeys(txids, epoch);
+    // Entries kept from the old batch are only valid for its epoch; if that
+    // changed in the meantime, the next call looks them up again.
+    new_batch->epoch = refresh ? epoch : batch->epoch;
+
+    const size_t kept = new_batch->entries.size();
+    for (size_t i = 0; i < lookup.size(); ++i) {
+        if (keys[i]) new_batch->entries.push_back({*keys[i], lookup[i].wtxid, lookup[i].time});
     }
-};
+    const auto by_key = [](const TxRelayBatch::Entry& a, const TxRelayBatch::Entry& b) { return a.key < b.key; };
+    std::sort(new_batch->entries.begin() + kept, new_batch->entries.end(), by_key);
+    std::inplace_merge(new_batch->entries.begin(), new_batch->entries.begin() + kept, new_batch->entries.end(), by_key);
+    // A transaction queued more than once has the same key each time.
+    new_batch->entries.erase(std::unique(new_batch->entries.begin(), new_batch->entries.end(),
+        [](const TxRelayBatch::Entry& a, const TxRelayBatch::Entry& b) { return a.key.m_txid == b.key.m_txid; }), new_batch->entries.end());
+
+    new_batch->hashes.reserve(new_batch->entries.size() * 2);
+    for (const TxRelayBatch::Entry& entry : new_batch->entries) {
+        new_batch->hashes.insert(entry.key.m_txid);
+        new_batch->hashes.insert(entry.wtxid);
+    }
+
+    LOCK(g_cs_tx_relay_batch);
+    g_tx_relay_batch = new_batch;
+    return new_batch;
 }
+} // namespace
 
 bool PeerManager::SendMessages(CNode* pto)
 {
     const Consensus::Params& consensusParams = m_chainparams.GetConsensus();
+    PeerMsgTimer timer{GetPeerRef(pto->GetId()), nullptr};
 
     // We must call MaybeDiscourageAndDisconnect first, to ensure that we'll
     // disconnect misbehaving peers even before the version handshake is complete.
@@ -4410,30 +4619,47 @@ bool PeerManager::SendMessages(CNode* pto)
 
                 // Determine transactions to relay
                 if (fSendTrickle) {
-                    // Produce a vector with all candidates for sending
-                    std::vector<std::set<uint256>::iterator> vInvTx;
-                    vInvTx.reserve(pto->m_tx_relay->setInventoryTxToSend.size());
-                    for (std::set<uint256>::iterator it = pto->m_tx_relay->setInventoryTxToSend.begin(); it != pto->m_tx_relay->setInventoryTxToSend.end(); it++) {
-                        vInvTx.push_back(it);
+                    // Transactions in the shared batch are announced in batch
+                    // order. The few others (queued too long ago, or that
+                    // didn't fit) are looked up and sorted here, and merged in.
+                    const auto batch = GetTxRelayBatch(m_mempool, current_time);
+                    std::vector<InvTxCandidate> vInvTx;
+                    for (std::set<uint256>::iterator it = pto->m_tx_relay->setInventoryTxToSend.begin(); it != pto->m_tx_relay->setInventoryTxToSend.end();) {
+                        if (batch->hashes.count(*it) == 0) {
+                            const auto key = m_mempool.GetRelayOrderKey(*it, state.m_wtxid_relay);
+                            if (!key) {
+                                // Not in the mempool anymore? don't bother sending it.
+                                it = pto->m_tx_relay->setInventoryTxToSend.erase(it);
+                                continue;
+                            }
+                            vInvTx.emplace_back(*key, it);
+                        }
+                        ++it;
                     }
+                    std::sort(vInvTx.begin(), vInvTx.end(), [](const InvTxCandidate& a, const InvTxCandidate& b) { return a.first < b.first; });
                     CFeeRate filterrate;
                     {
                         LOCK(pto->m_tx_relay->cs_feeFilter);
                         filterrate = CFeeRate(pto->m_tx_relay->minFeeFilter);
                     }
-                    // Topologically and fee-rate sort the inventory we send for privacy and priority reasons.
-                    // A heap is used so that not all items need sorting if only a few are being sent.
-                    CompareInvMempoolOrder compareInvMempoolOrder(&m_mempool, state.m_wtxid_relay);
-                    std::make_heap(vInvTx.begin(), vInvTx.end(), compareInvMempoolOrder);
                     // No reason to drain out at many times the network's capacity,
                     // especially since we have many peers and some will draw much shorter delays.
                     unsigned int nRelayedTransactions = 0;
+                    auto batch_it = batch->entries.begin();
+                    auto other_it = vInvTx.begin();
                     LOCK(pto->m_tx_relay->cs_filter);
-                    while (!vInvTx.empty() && nRelayedTransactions < INVENTORY_BROADCAST_MAX) {
-                        // Fetch the top element from the heap
-                        std::pop_heap(vInvTx.begin(), vInvTx.end(), compareInvMempoolOrder);
-                        std::set<uint256>::iterator it = vInvTx.back();
-                        vInvTx.pop_back();
+                    while (!pto->m_tx_relay->setInventoryTxToSend.empty() && nRelayedTransactions < INVENTORY_BROADCAST_MAX) {
+                        // Fetch the next transaction in relay order
+                        std::set<uint256>::iterator it;
+                        if (other_it != vInvTx.end() && (batch_it == batch->entries.end() || other_it->first < batch_it->key)) {
+                            it = (other_it++)->second;
+                        } else if (batch_it != batch->entries.end()) {
+                            it = pto->m_tx_relay->setInventoryTxToSend.find(state.m_wtxid_relay ? batch_it->wtxid : batch_it->key.m_txid);
+                            ++batch_it;
+                            if (it == pto->m_tx_relay->setInventoryTxToSend.end()) continue;
+                        } else {
+                            break;
+                        }
                         uint256 hash = *it;
                         CInv inv(state.m_wtxid_relay ? MSG_WTX : MSG_TX, hash);
                         // Remove it from the to-be-sent set
@@ -4561,10 +4787,11 @@ bool PeerManager::SendMessages(CNode* pto)
         // Message: getdata (blocks)
         //
         std::vector<CInv> vGetData;
-        if (!pto->fClient && ((fFetch && !pto->m_limited_node) || !::ChainstateActive().IsInitialBlockDownload()) && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+        UpdateBlocksInFlightTarget(state, pto->nMinPingUsecTime);
+        if (!pto->fClient && ((fFetch && !pto->m_limited_node) || !::ChainstateActive().IsInitialBlockDownload()) && state.nBlocksInFlight < state.m_blocks_in_flight_target) {
             std::vector<const CBlockIndex*> vToDownload;
             NodeId staller = -1;
-            FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller, consensusParams);
+            FindNextBlocksToDownload(pto->GetId(), state.m_blocks_in_flight_target - state.nBlocksInFlight, vToDownload, staller, consensusParams);
             for (const CBlockIndex *pindex : vToDownload) {
                 uint32_t nFetchFlags = GetFetchFlags(*pto);
                 vGetData.push_back(CInv(MSG_BLOCK | nFetchFlags, pindex->GetBlockHash()));
@@ -4573,8 +4800,12 @@ bool PeerManager::SendMessages(CNode* pto)
                     pindex->nHeight, pto->GetId());
             }
             if (state.nBlocksInFlight == 0 && staller != -1) {
-                if (State(staller)->nStallingSince == 0) {
-                    State(staller)->nStallingSince = count_microseconds(current_time);
+                CNodeState* staller_state = State(staller);
+                if (staller_state->nStallingSince == 0) {
+                    staller_state->nStallingSince = count_microseconds(current_time);
+                    // Until it proves otherwise, assume the staller is slow so that it gets
+                    // only a small share of the window once it catches up.
+                    staller_state->m_block_delivery_time = std::max<int64_t>(staller_state->m_block_delivery_time, count_microseconds(BLOCK_DOWNLOAD_QUEUE_TIME));
                     LogPrint(BCLog::NET, "Stall started peer=%d\n", staller);
                 }
             }
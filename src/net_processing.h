@@ -12,6 +12,9 @@
 #include <txrequest.h>
 #include <validationinterface.h>
 
+#include <array>
+#include <chrono>
+
 class BlockTransactionsRequest;
 class BlockValidationState;
 class CBlockHeader;
@@ -32,6 +35,29 @@ static const bool DEFAULT_PEERBLOCKFILTERS = false;
 /** Threshold for marking a node to be discouraged, e.g. disconnected and added to the discouragement filter. */
 static const int DISCOURAGEMENT_THRESHOLD{100};
 
+/** Time the message handler thread spent on one kind of work for a peer. */
+struct MsgProcessingTime {
+    /** Number of histogram buckets. Bucket i counts the calls that took less than 2^i microseconds
+     *  (and at least 2^(i-1)), the last one also counts everything slower. */
+    static constexpr size_t HISTOGRAM_BUCKETS{24};
+
+    uint64_t m_count{0};
+    std::chrono::microseconds m_total{0};
+    std::chrono::microseconds m_max{0};
+    std::array<uint64_t, HISTOGRAM_BUCKETS> m_histogram{};
+
+    void Add(std::chrono::microseconds elapsed);
+};
+
+/** Time spent processing messages from and sending messages to a peer. */
+struct PeerMsgTimeStats {
+    /** Time spent in ProcessMessage, by message type. Unknown message types are accounted
+     *  for under NET_MESSAGE_COMMAND_OTHER. */
+    std::map<std::string, MsgProcessingTime> m_process_message;
+    /** Time spent in SendMessages */
+    MsgProcessingTime m_send_messages;
+};
+
 struct CNodeStateStats {
     int m_misbehavior_score = 0;
     int nSyncHeight = -1;
@@ -68,7 +94,18 @@ struct Peer {
     /** Work queue of items requested by this peer **/
     std::deque<CInv> m_getdata_requests GUARDED_BY(m_getdata_requests_mutex);
 
-    explicit Peer(NodeId id) : m_id(id) {}
+    /** Protects m_msg_time_stats */
+    Mutex m_msg_time_stats_mutex;
+    /** Time the message handler thread spent on this peer */
+    PeerMsgTimeStats m_msg_time_stats GUARDED_BY(m_msg_time_stats_mutex);
+
+    explicit Peer(NodeId id) : m_id(id)
+    {
+        for (const std::string& msg_type : getAllNetMessageTypes()) {
+            m_msg_time_stats.m_process_message[msg_type];
+        }
+        m_msg_time_stats.m_process_message[NET_MESSAGE_COMMAND_OTHER];
+    }
 };
 
 using PeerRef = std::shared_ptr<Peer>;
@@ -139,6 +176,9 @@ public:
     /** Get statistics from node state */
     bool GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats);
 
+    /** Get the time spent processing messages from and sending messages to a peer */
+    bool GetPeerMsgTimeStats(NodeId nodeid, PeerMsgTimeStats& stats) const;
+
     /** Whether this node ignores txs received over p2p. */
     bool IgnoresIncomingTxs() {return m_ignore_incoming_txs;};
 
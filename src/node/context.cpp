@@ -9,6 +9,7 @@
 #include <net.h>
 #include <net_processing.h>
 #include <policy/fees.h>
+#include <policy/mempool_fees.h>
 #include <scheduler.h>
 #include <txmempool.h>
 
@@ -0,0 +1,130 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <policy/mempool_fees.h>
+
+#include <consensus/consensus.h>
+#include <miner.h>
+#include <txmempool.h>
+#include <util/time.h>
+
+#include <algorithm>
+#include <limits>
+
+MempoolFeeEstimator::MempoolFeeEstimator(const CTxMemPool& mempool, unsigned int block_weight)
+    : m_mempool(mempool), m_block_weight(block_weight) {}
+
+std::vector<CFeeRate> MempoolFeeEstimator::SimulateBlocks() const
+{
+    std::vector<CFeeRate> block_feerates;
+
+    LOCK(m_mempool.cs);
+    // Packages are selected in the order BlockAssembler::addPackageTxs() uses:
+    // by ancestor feerate, where the ancestor state of transactions some of
+    // whose ancestors were already selected is kept up to date in
+    // modified_entries. Unlike BlockAssembler, a package that doesn't fit ends
+    // the block instead of being skipped in favour of smaller ones, as those
+    // would make the lowest feerate of the block unrepresentative of what it
+    // took to get in. Only the packages of the simulated blocks are visited.
+    indexed_modified_transaction_set modified_entries;
+    CTxMemPool::setEntries in_blocks;
+    uint64_t block_weight{0};
+    CFeeRate block_min_feerate{std::numeric_limits<CAmount>::max()};
+    const uint64_t no_limit{std::numeric_limits<uint64_t>::max()};
+    std::string dummy;
+    const auto& by_score = m_mempool.mapTx.get<ancestor_score>();
+    auto mi = by_score.begin();
+    while (mi != by_score.end() || !modified_entries.empty()) {
+        // mapTx entries that were selected or whose ancestor state is stale are skipped.
+        if (mi != by_score.end() && (in_blocks.count(m_mempool.mapTx.project<0>(mi)) || modified_entries.count(m_mempool.mapTx.project<0>(mi)))) {
+            ++mi;
+            continue;
+        }
+
+        CTxMemPool::txiter iter;
+        uint64_t package_size;
+        CAmount package_fee;
+        const auto modit = modified_entries.get<ancestor_score>().begin();
+        if (mi == by_score.end() || (modit != modified_entries.get<ancestor_score>().end() &&
+                                     CompareTxMemPoolEntryByAncestorFee()(*modit, CTxMemPoolModifiedEntry(m_mempool.mapTx.project<0>(mi))))) {
+            iter = modit->iter;
+            package_size = modit->nSizeWithAncestors;
+            package_fee = modit->nModFeesWithAncestors;
+        } else {
+            iter = m_mempool.mapTx.project<0>(mi);
+            package_size = iter->GetSizeWithAncestors();
+            package_fee = iter->GetModFeesWithAncestors();
+            ++mi;
+        }
+
+        const uint64_t package_weight{WITNESS_SCALE_FACTOR * package_size};
+        if (block_weight > 0 && block_weight + package_weight > m_block_weight) {
+            // Consecutive blocks can't require a higher feerate than the ones before
+            block_feerates.push_back(block_feerates.empty() ? block_min_feerate : std::min(block_feerates.back(), block_min_feerate));
+            if (block_feerates.size() == MEMPOOL_FEE_ESTIMATE_MAX_TARGET) break;
+            block_weight = 0;
+            block_min_feerate = CFeeRate(std::numeric_limits<CAmount>::max());
+        }
+        block_weight += package_weight;
+        block_min_feerate = std::min(block_min_feerate, CFeeRate(package_fee, package_size));
+
+        CTxMemPool::setEntries package;
+        m_mempool.CalculateMemPoolAncestors(*iter, package, no_limit, no_limit, no_limit, no_limit, dummy, false);
+        package.insert(iter);
+        for (auto package_it = package.begin(); package_it != package.end();) {
+            if (in_blocks.count(*package_it)) {
+                package_it = package.erase(package_it);
+            } else {
+                in_blocks.insert(*package_it);
+                modified_entries.erase(*package_it);
+                ++package_it;
+            }
+        }
+
+        // Take the selected transactions out of the ancestor state of their descendants.
+        for (CTxMemPool::txiter added : package) {
+            CTxMemPool::setEntries descendants;
+            m_mempool.CalculateDescendants(added, descendants);
+            for (CTxMemPool::txiter desc : descendants) {
+                if (in_blocks.count(desc)) continue;
+                auto mit = modified_entries.find(desc);
+                if (mit == modified_entries.end()) mit = modified_entries.insert(CTxMemPoolModifiedEntry(desc)).first;
+                modified_entries.modify(mit, [&](CTxMemPoolModifiedEntry& entry) {
+                    entry.nSizeWithAncestors -= added->GetTxSize();
+                    entry.nModFeesWithAncestors -= added->GetModifiedFee();
+                    entry.nSigOpCostWithAncestors -= added->GetSigOpCost();
+                });
+            }
+        }
+    }
+    // The last, partially filled block doesn't constrain the feerate.
+    return block_feerates;
+}
+
+void MempoolFeeEstimator::BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex)
+{
+    LOCK(m_mutex);
+    m_stale = true;
+}
+
+CFeeRate MempoolFeeEstimator::EstimateFee(unsigned int target, unsigned int* returned_target)
+{
+    if (target < 1 || target > MEMPOOL_FEE_ESTIMATE_MAX_TARGET) return CFeeRate(0);
+
+    LOCK(m_mutex);
+    const auto now{GetTime<std::chrono::seconds>()};
+    if (m_stale || now - m_last_update >= MEMPOOL_FEE_ESTIMATE_INTERVAL) {
+        m_block_feerates = SimulateBlocks();
+        m_last_update = now;
+        m_stale = false;
+    }
+    if (target > m_block_feerates.size()) return CFeeRate(0);
+    const CFeeRate feerate{m_block_feerates[target - 1]};
+    if (returned_target) {
+        // A block's feerate is capped at that of the blocks before it, so it
+        // may have been found at a lower target already.
+        *returned_target = std::find(m_block_feerates.begin(), m_block_feerates.end(), feerate) - m_block_feerates.begin() + 1;
+    }
+    return feerate;
+}
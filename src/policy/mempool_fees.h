@@ -0,0 +1,71 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_POLICY_MEMPOOL_FEES_H
+#define BITCOIN_POLICY_MEMPOOL_FEES_H
+
+#include <policy/feerate.h>
+#include <sync.h>
+#include <validationinterface.h>
+
+#include <chrono>
+#include <vector>
+
+class CTxMemPool;
+
+/** Default for -mempoolfeeestimates */
+static constexpr bool DEFAULT_MEMPOOL_FEE_ESTIMATES{false};
+/** Number of blocks simulated from the mempool, the highest target a mempool based estimate is given for */
+static constexpr unsigned int MEMPOOL_FEE_ESTIMATE_MAX_TARGET{25};
+/** Maximum age of the simulated blocks while the tip doesn't change */
+static constexpr std::chrono::seconds MEMPOOL_FEE_ESTIMATE_INTERVAL{10};
+
+/**
+ * Estimates feerates from the current contents of the mempool, complementing
+ * CBlockPolicyEstimator (which only learns from past confirmations and is
+ * therefore slow to react to sudden changes in demand).
+ *
+ * The mempool is laid out into consecutive simulated blocks, selecting
+ * transactions with their unconfirmed ancestors in order of ancestor feerate
+ * like BlockAssembler does. A transaction can expect to confirm within N
+ * blocks if its feerate is higher than the lowest feerate that made it into
+ * the Nth simulated block.
+ *
+ * The simulation is cached, and only redone after a new block was connected
+ * or once it is older than MEMPOOL_FEE_ESTIMATE_INTERVAL, so that estimates
+ * stay cheap to query.
+ */
+class MempoolFeeEstimator final : public CValidationInterface
+{
+private:
+    const CTxMemPool& m_mempool;
+    const unsigned int m_block_weight;
+
+    mutable Mutex m_mutex;
+    //! Lowest feerate that is included within each number of blocks, non-increasing.
+    std::vector<CFeeRate> m_block_feerates GUARDED_BY(m_mutex);
+    std::chrono::seconds m_last_update GUARDED_BY(m_mutex){0};
+    bool m_stale GUARDED_BY(m_mutex){true};
+
+    std::vector<CFeeRate> SimulateBlocks() const;
+
+protected:
+    void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex) override;
+
+public:
+    /** @param[in] block_weight The weight available to the transactions of a simulated block. */
+    explicit MempoolFeeEstimator(const CTxMemPool& mempool, unsigned int block_weight);
+
+    /**
+     * Return the feerate needed to confirm within target blocks according to
+     * the current mempool, or CFeeRate(0) if the mempool doesn't constrain it
+     * (it would be cleared within fewer blocks) or target is out of range.
+     *
+     * @param[out] returned_target The lowest number of blocks this feerate
+     *                             already confirms within, if an estimate is returned.
+     */
+    CFeeRate EstimateFee(unsigned int target, unsigned int* returned_target = nullptr);
+};
+
+#endif // BITCOIN_POLICY_MEMPOOL_FEES_H
@@ -262,7 +262,7 @@ public:
         fill(item_ptr(0), other.begin(),  other.end());
     }
 
-    prevector(prevector<N, T, Size, Diff>&& other) {
+    prevector(prevector<N, T, Size, Diff>&& other) noexcept {
         swap(other);
     }
 
@@ -274,7 +274,7 @@ public:
         return *this;
     }
 
-    prevector& operator=(prevector<N, T, Size, Diff>&& other) {
+    prevector& operator=(prevector<N, T, Size, Diff>&& other) noexcept {
         swap(other);
         return *this;
     }
@@ -458,7 +458,7 @@ public:
         return *item_ptr(size() - 1);
     }
 
-    void swap(prevector<N, T, Size, Diff>& other) {
+    void swap(prevector<N, T, Size, Diff>& other) noexcept {
         std::swap(_union, other._union);
         std::swap(_size, other._size);
     }
@@ -5,7 +5,9 @@
 
 #include <primitives/transaction.h>
 
+#include <crypto/sha256.h>
 #include <hash.h>
+#include <streams.h>
 #include <tinyformat.h>
 #include <util/strencodings.h>
 
@@ -79,6 +81,59 @@ uint256 CTransaction::ComputeWitnessHash() const
 
 CTransaction::CTransaction(const CMutableTransaction& tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
 CTransaction::CTransaction(CMutableTransaction&& tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
+CTransaction::CTransaction(CMutableTransaction&& tx, const uint256& hash, const uint256& witness_hash, PrecomputedHashesTag) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{hash}, m_witness_hash{witness_hash} {}
+
+std::vector<CTransactionRef> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs)
+{
+    std::vector<CTransactionRef> ret;
+    ret.reserve(txs.size());
+    if (SHA256DMultiLanes() == 0) {
+        // Without parallel lanes, buffering the serializations first only adds
+        // a copy: hash each transaction as it is serialized instead.
+        for (CMutableTransaction& tx : txs) {
+            ret.push_back(MakeTransactionRef(std::move(tx)));
+        }
+        return ret;
+    }
+
+    // Serialize all transactions into one buffer, once without witness for the
+    // txid and, if they have a witness, once more with it for the wtxid.
+    std::vector<unsigned char> buffer;
+    std::vector<size_t> offsets;
+    for (const CMutableTransaction& tx : txs) {
+        offsets.push_back(buffer.size());
+        CVectorWriter(SER_GETHASH, SERIALIZE_TRANSACTION_NO_WITNESS, buffer, buffer.size()) << tx;
+        if (tx.HasWitness()) {
+            offsets.push_back(buffer.size());
+            CVectorWriter(SER_GETHASH, 0, buffer, buffer.size()) << tx;
+        }
+    }
+    offsets.push_back(buffer.size());
+
+    std::vector<const unsigned char*> inputs;
+    std::vector<size_t> lengths;
+    for (size_t i = 0; i + 1 < offsets.size(); ++i) {
+        inputs.push_back(buffer.data() + offsets[i]);
+        lengths.push_back(offsets[i + 1] - offsets[i]);
+    }
+    std::vector<unsigned char> hashes(CSHA256::OUTPUT_SIZE * inputs.size());
+    SHA256DMulti(hashes.data(), inputs.data(), lengths.data(), inputs.size());
+
+    auto hash_it = hashes.cbegin();
+    for (CMutableTransaction& tx : txs) {
+        uint256 hash, witness_hash;
+        std::copy(hash_it, hash_it + CSHA256::OUTPUT_SIZE, hash.begin());
+        hash_it += CSHA256::OUTPUT_SIZE;
+        if (tx.HasWitness()) {
+            std::copy(hash_it, hash_it + CSHA256::OUTPUT_SIZE, witness_hash.begin());
+            hash_it += CSHA256::OUTPUT_SIZE;
+        } else {
+            witness_hash = hash;
+        }
+        ret.push_back(std::make_shared<const CTransaction>(std::move(tx), hash, witness_hash, CTransaction::PrecomputedHashesTag{}));
+    }
+    return ret;
+}
 
 CAmount CTransaction::GetValueOut() const
 {
@@ -8,11 +8,15 @@
 
 #include <stdint.h>
 #include <amount.h>
+#include <crypto/sha256.h>
 #include <script/script.h>
 #include <serialize.h>
 #include <uint256.h>
 
+#include <algorithm>
+#include <memory>
 #include <tuple>
+#include <vector>
 
 /**
  * A flag that is ORed into the protocol version to designate that a transaction
@@ -281,9 +285,19 @@ private:
     uint256 ComputeWitnessHash() const;
 
 public:
+    /** Only MakeTransactionRefs can create this, and so use the constructor
+     *  taking precomputed hashes (through std::make_shared). */
+    class PrecomputedHashesTag
+    {
+        PrecomputedHashesTag() {}
+        friend std::vector<std::shared_ptr<const CTransaction>> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs);
+    };
+
     /** Convert a CMutableTransaction into a CTransaction. */
     explicit CTransaction(const CMutableTransaction& tx);
     CTransaction(CMutableTransaction&& tx);
+    /** Construct with hashes that were already computed, see MakeTransactionRefs. */
+    CTransaction(CMutableTransaction&& tx, const uint256& hash, const uint256& witness_hash, PrecomputedHashesTag);
 
     template <typename Stream>
     inline void Serialize(Stream& s) const {
@@ -386,6 +400,40 @@ struct CMutableTransaction
 typedef std::shared_ptr<const CTransaction> CTransactionRef;
 template <typename Tx> static inline CTransactionRef MakeTransactionRef(Tx&& txIn) { return std::make_shared<const CTransaction>(std::forward<Tx>(txIn)); }
 
+/**
+ * Convert multiple transactions at once. Their txids and wtxids are computed
+ * together, which allows hashing several transactions in parallel.
+ */
+std::vector<CTransactionRef> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs);
+
+/** Formatter for a vector of transactions that computes their hashes together when deserializing (see MakeTransactionRefs). */
+struct TransactionsFormatter
+{
+    template <typename Stream>
+    void Ser(Stream& s, const std::vector<CTransactionRef>& vtx)
+    {
+        s << vtx;
+    }
+
+    template <typename Stream>
+    void Unser(Stream& s, std::vector<CTransactionRef>& vtx)
+    {
+        if (SHA256DMultiLanes() == 0) {
+            // Nothing to gain from hashing them together
+            s >> vtx;
+            return;
+        }
+        std::vector<CMutableTransaction> txs;
+        const uint64_t count{ReadCompactSize(s)};
+        // Limit the preallocation like the generic vector deserialization does
+        txs.reserve(std::min<uint64_t>(count, 5000000 / sizeof(CMutableTransaction)));
+        while (txs.size() < count) {
+            txs.emplace_back(deserialize, s);
+        }
+        vtx = MakeTransactionRefs(std::move(txs));
+    }
+};
+
 /** A generic txid reference (txid or wtxid). */
 class GenTxid
 {
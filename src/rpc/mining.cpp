@@ -7,6 +7,7 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <consensus/consensus.h>
+#include <consensus/merkle.h>
 #include <consensus/params.h>
 #include <consensus/validation.h>
 #include <core_io.h>
@@ -15,6 +16,7 @@
 #include <net.h>
 #include <node/context.h>
 #include <policy/fees.h>
+#include <policy/mempool_fees.h>
 #include <pow.h>
 #include <rpc/blockchain.h>
 #include <rpc/mining.h>
@@ -109,23 +111,30 @@ static bool GenerateBlock(ChainstateManager& chainman, CBlock& block, uint64_t&
 {
     block_hash.SetNull();
 
+    IncrementalMerkleTree merkle_tree;
+    const CBlockIndex* pindex_prev;
     {
         LOCK(cs_main);
-        IncrementExtraNonce(&block, ::ChainActive().Tip(), extra_nonce);
+        pindex_prev = ::ChainActive().Tip();
+        IncrementExtraNonce(&block, pindex_prev, extra_nonce, &merkle_tree);
     }
 
     CChainParams chainparams(Params());
 
-    while (max_tries > 0 && block.nNonce < std::numeric_limits<uint32_t>::max() && !CheckProofOfWork(block.GetHash(), block.nBits, chainparams.GetConsensus()) && !ShutdownRequested()) {
-        ++block.nNonce;
+    while (max_tries > 0 && !CheckProofOfWork(block.GetHash(), block.nBits, chainparams.GetConsensus()) && !ShutdownRequested()) {
+        if (block.nNonce == std::numeric_limits<uint32_t>::max()) {
+            // Out of nonces: change the coinbase, which only rehashes its path in the merkle tree
+            LOCK(cs_main);
+            IncrementExtraNonce(&block, pindex_prev, extra_nonce, &merkle_tree);
+            block.nNonce = 0;
+        } else {
+            ++block.nNonce;
+        }
         --max_tries;
     }
     if (max_tries == 0 || ShutdownRequested()) {
         return false;
     }
-    if (block.nNonce == std::numeric_limits<uint32_t>::max()) {
-        return true;
-    }
 
     std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(block);
     if (!chainman.ProcessNewBlock(chainparams, shared_pblock, true, nullptr)) {
@@ -160,10 +169,8 @@ static UniValue generateBlocks(ChainstateManager& chainman, const CTxMemPool& me
             break;
         }
 
-        if (!block_hash.IsNull()) {
-            ++nHeight;
-            blockHashes.push_back(block_hash.GetHex());
-        }
+        ++nHeight;
+        blockHashes.push_back(block_hash.GetHex());
     }
     return blockHashes;
 }
@@ -384,7 +391,7 @@ static RPCHelpMan generateblock()
     uint64_t max_tries{DEFAULT_MAX_TRIES};
     unsigned int extra_nonce{0};
 
-    if (!GenerateBlock(EnsureChainman(request.context), block, max_tries, extra_nonce, block_hash) || block_hash.IsNull()) {
+    if (!GenerateBlock(EnsureChainman(request.context), block, max_tries, extra_nonce, block_hash)) {
         throw JSONRPCError(RPC_MISC_ERROR, "Failed to make block.");
     }
 
@@ -493,6 +500,50 @@ static UniValue BIP22ValidationResult(const BlockValidationState& state)
     return "valid?";
 }
 
+/** Serialize the transactions of a block template for getblocktemplate. */
+static UniValue BlockTemplateTransactionsToJSON(const CBlockTemplate& block_template, bool pre_segwit)
+{
+    UniValue transactions(UniValue::VARR);
+    std::map<uint256, int64_t> setTxIndex;
+    int i = 0;
+    for (const auto& it : block_template.block.vtx) {
+        const CTransaction& tx = *it;
+        uint256 txHash = tx.GetHash();
+        setTxIndex[txHash] = i++;
+
+        if (tx.IsCoinBase())
+            continue;
+
+        UniValue entry(UniValue::VOBJ);
+
+        entry.pushKV("data", EncodeHexTx(tx));
+        entry.pushKV("txid", txHash.GetHex());
+        entry.pushKV("hash", tx.GetWitnessHash().GetHex());
+
+        UniValue deps(UniValue::VARR);
+        for (const CTxIn &in : tx.vin)
+        {
+            if (setTxIndex.count(in.prevout.hash))
+                deps.push_back(setTxIndex[in.prevout.hash]);
+        }
+        entry.pushKV("depends", deps);
+
+        int index_in_template = i - 1;
+        entry.pushKV("fee", block_template.vTxFees[index_in_template]);
+        int64_t nTxSigOps = block_template.vTxSigOpsCost[index_in_template];
+        if (pre_segwit) {
+            CHECK_NONFATAL(nTxSigOps % WITNESS_SCALE_FACTOR == 0);
+            nTxSigOps /= WITNESS_SCALE_FACTOR;
+        }
+        entry.pushKV("sigops", nTxSigOps);
+        entry.pushKV("weight", GetTransactionWeight(tx));
+
+        transactions.push_back(entry);
+    }
+
+    return transactions;
+}
+
 static std::string gbt_vb_name(const Consensus::DeploymentPos pos) {
     const struct VBDeploymentInfo& vbinfo = VersionBitsDeploymentInfo[pos];
     std::string s = vbinfo.name;
@@ -723,6 +774,9 @@ static RPCHelpMan getblocktemplate()
     static CBlockIndex* pindexPrev;
     static int64_t nStart;
     static std::unique_ptr<CBlockTemplate> pblocktemplate;
+    // Serializing every transaction of the template is a large part of the
+    // cost of a call, so it is only done when the template is rebuilt.
+    static UniValue transactions;
     if (pindexPrev != ::ChainActive().Tip() ||
         (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5))
     {
@@ -740,6 +794,9 @@ static RPCHelpMan getblocktemplate()
         if (!pblocktemplate)
             throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
 
+        const bool pre_segwit = (pindexPrevNew->nHeight + 1 < Params().GetConsensus().SegwitHeight);
+        transactions = BlockTemplateTransactionsToJSON(*pblocktemplate, pre_segwit);
+
         // Need to update only after we know CreateNewBlock succeeded
         pindexPrev = pindexPrevNew;
     }
@@ -756,44 +813,6 @@ static RPCHelpMan getblocktemplate()
 
     UniValue aCaps(UniValue::VARR); aCaps.push_back("proposal");
 
-    UniValue transactions(UniValue::VARR);
-    std::map<uint256, int64_t> setTxIndex;
-    int i = 0;
-    for (const auto& it : pblock->vtx) {
-        const CTransaction& tx = *it;
-        uint256 txHash = tx.GetHash();
-        setTxIndex[txHash] = i++;
-
-        if (tx.IsCoinBase())
-            continue;
-
-        UniValue entry(UniValue::VOBJ);
-
-        entry.pushKV("data", EncodeHexTx(tx));
-        entry.pushKV("txid", txHash.GetHex());
-        entry.pushKV("hash", tx.GetWitnessHash().GetHex());
-
-        UniValue deps(UniValue::VARR);
-        for (const CTxIn &in : tx.vin)
-        {
-            if (setTxIndex.count(in.prevout.hash))
-                deps.push_back(setTxIndex[in.prevout.hash]);
-        }
-        entry.pushKV("depends", deps);
-
-        int index_in_template = i - 1;
-        entry.pushKV("fee", pblocktemplate->vTxFees[index_in_template]);
-        int64_t nTxSigOps = pblocktemplate->vTxSigOpsCost[index_in_template];
-        if (fPreSegWit) {
-            CHECK_NONFATAL(nTxSigOps % WITNESS_SCALE_FACTOR == 0);
-            nTxSigOps /= WITNESS_SCALE_FACTOR;
-        }
-        entry.pushKV("sigops", nTxSigOps);
-        entry.pushKV("weight", GetTransactionWeight(tx));
-
-        transactions.push_back(entry);
-    }
-
     UniValue aux(UniValue::VOBJ);
 
     arith_uint256 hashTarget = arith_uint256().SetCompact(pblock->nBits);
@@ -1039,7 +1058,9 @@ static RPCHelpMan estimatesmartfee()
                 RPCResult{
                     RPCResult::Type::OBJ, "", "",
                     {
-                        {RPCResult::Type::NUM, "feerate", /* optional */ true, "estimate fee rate in " + CURRENCY_UNIT + "/kB (only present if no errors were encountered)"},
+                        {RPCResult::Type::NUM, "feerate", /* optional */ true, "estimate fee rate in " + CURRENCY_UNIT + "/kB (only present if no errors were encountered)\n"
+            "With -mempoolfeeestimates, this is at least the feerate needed to be included within\n"
+            "conf_target blocks simulated from the current mempool."},
                         {RPCResult::Type::ARR, "errors", /* optional */ true, "Errors encountered during processing (if there are any)",
                             {
                                 {RPCResult::Type::STR, "", "error"},
@@ -1075,6 +1096,17 @@ static RPCHelpMan estimatesmartfee()
     UniValue errors(UniValue::VARR);
     FeeCalculation feeCalc;
     CFeeRate feeRate = fee_estimator.estimateSmartFee(conf_target, &feeCalc, conservative);
+    const NodeContext& node = EnsureNodeContext(request.context);
+    if (node.mempool_fee_estimator) {
+        // Confirmations only show a rise in demand with a delay, while the
+        // mempool already reflects it.
+        unsigned int mempool_target;
+        const CFeeRate mempool_fee_rate{node.mempool_fee_estimator->EstimateFee(conf_target, &mempool_target)};
+        if (mempool_fee_rate > feeRate) {
+            feeRate = mempool_fee_rate;
+            feeCalc.returnedTarget = mempool_target;
+        }
+    }
     if (feeRate != CFeeRate(0)) {
         result.pushKV("feerate", ValueFromAmount(feeRate.GetFeePerK()));
     } else {
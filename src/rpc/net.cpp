@@ -272,6 +272,89 @@ static RPCHelpMan getpeerinfo()
     };
 }
 
+static UniValue MsgProcessingTimeToUniv(const MsgProcessingTime& time)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("count", time.m_count);
+    obj.pushKV("total_us", count_microseconds(time.m_total));
+    obj.pushKV("max_us", count_microseconds(time.m_max));
+    UniValue histogram(UniValue::VARR);
+    for (const uint64_t n : time.m_histogram) {
+        histogram.push_back(n);
+    }
+    obj.pushKV("histogram", histogram);
+    return obj;
+}
+
+static RPCHelpMan getmessagetimings()
+{
+    const std::vector<RPCResult> timing_doc{
+        {RPCResult::Type::NUM, "count", "Number of calls"},
+        {RPCResult::Type::NUM, "total_us", "Total time spent, in microseconds"},
+        {RPCResult::Type::NUM, "max_us", "Longest single call, in microseconds"},
+        {RPCResult::Type::ARR, "histogram", "",
+        {
+            {RPCResult::Type::NUM, "n", "Number of calls that took less than 2^i microseconds (and at least 2^(i-1)),\n"
+                                        "where i is the index in the array. The last entry also counts all slower calls."},
+        }},
+    };
+    return RPCHelpMan{"getmessagetimings",
+                "\nReturns the time the message handler thread spent on each connected peer, broken down by message type.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::ARR, "", "",
+                    {
+                        {RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::NUM, "id", "Peer index"},
+                            {RPCResult::Type::STR, "addr", "(host:port) The IP address and port of the peer"},
+                            {RPCResult::Type::OBJ, "sendmessages", "Time spent preparing messages to send to this peer", timing_doc},
+                            {RPCResult::Type::OBJ_DYN, "processmessage", "Time spent processing messages received from this peer",
+                            {
+                                {RPCResult::Type::OBJ, "msg", "Time spent processing messages of this type\n"
+                                                              "Message types that were never received are not listed.\n"
+                                                              "Time spent on unknown message types is listed under '" + NET_MESSAGE_COMMAND_OTHER + "'.", timing_doc},
+                            }},
+                        }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getmessagetimings", "")
+            + HelpExampleRpc("getmessagetimings", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    NodeContext& node = EnsureNodeContext(request.context);
+    if(!node.connman || !node.peerman) {
+        throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
+    }
+
+    std::vector<CNodeStats> vstats;
+    node.connman->GetNodeStats(vstats);
+
+    UniValue ret(UniValue::VARR);
+
+    for (const CNodeStats& stats : vstats) {
+        PeerMsgTimeStats time_stats;
+        if (!node.peerman->GetPeerMsgTimeStats(stats.nodeid, time_stats)) continue;
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("id", stats.nodeid);
+        obj.pushKV("addr", stats.addrName);
+        obj.pushKV("sendmessages", MsgProcessingTimeToUniv(time_stats.m_send_messages));
+        UniValue process_message(UniValue::VOBJ);
+        for (const auto& i : time_stats.m_process_message) {
+            if (i.second.m_count > 0) {
+                process_message.pushKV(i.first, MsgProcessingTimeToUniv(i.second));
+            }
+        }
+        obj.pushKV("processmessage", process_message);
+        ret.push_back(obj);
+    }
+
+    return ret;
+},
+    };
+}
+
 static RPCHelpMan addnode()
 {
     return RPCHelpMan{"addnode",
@@ -903,6 +986,7 @@ static const CRPCCommand commands[] =
     { "network",            "getconnectioncount",     &getconnectioncount,     {} },
     { "network",            "ping",                   &ping,                   {} },
     { "network",            "getpeerinfo",            &getpeerinfo,            {} },
+    { "network",            "getmessagetimings",      &getmessagetimings,      {} },
     { "network",            "addnode",                &addnode,                {"node","command"} },
     { "network",            "disconnectnode",         &disconnectnode,         {"address", "nodeid"} },
     { "network",            "getaddednodeinfo",       &getaddednodeinfo,       {"node"} },
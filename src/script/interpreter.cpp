@@ -12,8 +12,18 @@
 #include <script/script.h>
 #include <uint256.h>
 
+#include <optional>
+
 typedef std::vector<unsigned char> valtype;
 
+/**
+ * Element of the stack during script execution. Nearly all elements are
+ * signatures (at most 73 bytes), public keys, hashes or numbers, which fit in
+ * the inline buffer, so that pushing them doesn't allocate.
+ */
+using StackElement = prevector<80, unsigned char>;
+using Stack = std::vector<StackElement>;
+
 namespace {
 
 inline bool set_success(ScriptError* ret)
@@ -32,7 +42,7 @@ inline bool set_error(ScriptError* ret, const ScriptError serror)
 
 } // namespace
 
-bool CastToBool(const valtype& vch)
+static bool CastToBool(Span<const unsigned char> vch)
 {
     for (unsigned int i = 0; i < vch.size(); i++)
     {
@@ -47,20 +57,25 @@ bool CastToBool(const valtype& vch)
     return false;
 }
 
+bool CastToBool(const valtype& vch)
+{
+    return CastToBool(MakeSpan(vch));
+}
+
 /**
  * Script is a stack machine (like Forth) that evaluates a predicate
  * returning a bool indicating valid or not.  There are no loops.
  */
 #define stacktop(i)  (stack.at(stack.size()+(i)))
 #define altstacktop(i)  (altstack.at(altstack.size()+(i)))
-static inline void popstack(std::vector<valtype>& stack)
+static inline void popstack(Stack& stack)
 {
     if (stack.empty())
         throw std::runtime_error("popstack(): stack empty");
     stack.pop_back();
 }
 
-bool static IsCompressedOrUncompressedPubKey(const valtype &vchPubKey) {
+bool static IsCompressedOrUncompressedPubKey(Span<const unsigned char> vchPubKey) {
     if (vchPubKey.size() < CPubKey::COMPRESSED_SIZE) {
         //  Non-canonical public key: too short
         return false;
@@ -82,7 +97,7 @@ bool static IsCompressedOrUncompressedPubKey(const valtype &vchPubKey) {
     return true;
 }
 
-bool static IsCompressedPubKey(const valtype &vchPubKey) {
+bool static IsCompressedPubKey(Span<const unsigned char> vchPubKey) {
     if (vchPubKey.size() != CPubKey::COMPRESSED_SIZE) {
         //  Non-canonical public key: invalid length for compressed key
         return false;
@@ -104,7 +119,7 @@ bool static IsCompressedPubKey(const valtype &vchPubKey) {
  *
  * This function is consensus-critical since BIP66.
  */
-bool static IsValidSignatureEncoding(const std::vector<unsigned char> &sig) {
+bool static IsValidSignatureEncoding(Span<const unsigned char> sig) {
     // Format: 0x30 [total-length] 0x02 [R-length] [R] 0x02 [S-length] [S] [sighash]
     // * total-length: 1-byte length descriptor of everything that follows,
     //   excluding the sighash byte.
@@ -169,7 +184,7 @@ bool static IsValidSignatureEncoding(const std::vector<unsigned char> &sig) {
     return true;
 }
 
-bool static IsLowDERSignature(const valtype &vchSig, ScriptError* serror) {
+bool static IsLowDERSignature(Span<const unsigned char> vchSig, ScriptError* serror) {
     if (!IsValidSignatureEncoding(vchSig)) {
         return set_error(serror, SCRIPT_ERR_SIG_DER);
     }
@@ -186,7 +201,7 @@ bool static IsLowDERSignature(const valtype &vchSig, ScriptError* serror) {
     return true;
 }
 
-bool static IsDefinedHashtypeSignature(const valtype &vchSig) {
+bool static IsDefinedHashtypeSignature(Span<const unsigned char> vchSig) {
     if (vchSig.size() == 0) {
         return false;
     }
@@ -197,7 +212,7 @@ bool static IsDefinedHashtypeSignature(const valtype &vchSig) {
     return true;
 }
 
-bool CheckSignatureEncoding(const std::vector<unsigned char> &vchSig, unsigned int flags, ScriptError* serror) {
+bool CheckSignatureEncoding(Span<const unsigned char> vchSig, unsigned int flags, ScriptError* serror) {
     // Empty signature. Not strictly DER encoded, but allowed to provide a
     // compact way to provide an invalid signature for use with CHECK(MULTI)SIG
     if (vchSig.size() == 0) {
@@ -214,7 +229,7 @@ bool CheckSignatureEncoding(const std::vector<unsigned char> &vchSig, unsigned i
     return true;
 }
 
-bool static CheckPubKeyEncoding(const valtype &vchPubKey, unsigned int flags, const SigVersion &sigversion, ScriptError* serror) {
+bool static CheckPubKeyEncoding(Span<const unsigned char> vchPubKey, unsigned int flags, const SigVersion &sigversion, ScriptError* serror) {
     if ((flags & SCRIPT_VERIFY_STRICTENC) != 0 && !IsCompressedOrUncompressedPubKey(vchPubKey)) {
         return set_error(serror, SCRIPT_ERR_PUBKEYTYPE);
     }
@@ -225,7 +240,7 @@ bool static CheckPubKeyEncoding(const valtype &vchPubKey, unsigned int flags, co
     return true;
 }
 
-bool static CheckMinimalPush(const valtype& data, opcodetype opcode) {
+bool static CheckMinimalPush(Span<const unsigned char> data, opcodetype opcode) {
     // Excludes OP_1NEGATE, OP_1-16 since they are by definition minimal
     assert(0 <= opcode && opcode <= OP_PUSHDATA4);
     if (data.size() == 0) {
@@ -340,9 +355,46 @@ public:
         }
     }
 };
+
+/** An opcode of a DecodedScript. */
+struct DecodedOp {
+    opcodetype opcode;
+    //! Offset in the script of the data pushed by this opcode, which extends up to the next opcode.
+    uint32_t data_begin;
+    //! Offset in the script of the next opcode.
+    uint32_t next;
+};
+
+/**
+ * A script decoded into its opcodes ahead of execution, so that EvalScript
+ * doesn't need to parse while executing and can push data directly from the
+ * script. Scripts of common templates are decoded without allocating.
+ */
+class DecodedScript {
+public:
+    prevector<28, DecodedOp> ops;
+    //! Whether decoding stopped at an invalid opcode following ops.
+    bool invalid{false};
+
+    explicit DecodedScript(const CScript& script)
+    {
+        CScript::const_iterator pc = script.begin();
+        while (pc < script.end()) {
+            const uint32_t begin = pc - script.begin();
+            opcodetype opcode;
+            if (!script.GetOp(pc, opcode)) {
+                invalid = true;
+                break;
+            }
+            // Skip the opcode and, for OP_PUSHDATA1/2/4, the size of the push.
+            const uint32_t header = 1 + (opcode == OP_PUSHDATA1 ? 1 : opcode == OP_PUSHDATA2 ? 2 : opcode == OP_PUSHDATA4 ? 4 : 0);
+            ops.push_back({opcode, begin + header, uint32_t(pc - script.begin())});
+        }
+    }
+};
 }
 
-static bool EvalChecksigPreTapscript(const valtype& vchSig, const valtype& vchPubKey, CScript::const_iterator pbegincodehash, CScript::const_iterator pend, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror, bool& fSuccess)
+static bool EvalChecksigPreTapscript(Span<const unsigned char> vchSig, Span<const unsigned char> vchPubKey, CScript::const_iterator pbegincodehash, CScript::const_iterator pend, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror, bool& fSuccess)
 {
     assert(sigversion == SigVersion::BASE || sigversion == SigVersion::WITNESS_V0);
 
@@ -351,7 +403,7 @@ static bool EvalChecksigPreTapscript(const valtype& vchSig, const valtype& vchPu
 
     // Drop the signature in pre-segwit scripts but not segwit scripts
     if (sigversion == SigVersion::BASE) {
-        int found = FindAndDelete(scriptCode, CScript() << vchSig);
+        int found = FindAndDelete(scriptCode, CScript() << valtype(vchSig.begin(), vchSig.end()));
         if (found > 0 && (flags & SCRIPT_VERIFY_CONST_SCRIPTCODE))
             return set_error(serror, SCRIPT_ERR_SIG_FINDANDDELETE);
     }
@@ -368,7 +420,7 @@ static bool EvalChecksigPreTapscript(const valtype& vchSig, const valtype& vchPu
     return true;
 }
 
-static bool EvalChecksigTapscript(const valtype& sig, const valtype& pubkey, ScriptExecutionData& execdata, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror, bool& success)
+static bool EvalChecksigTapscript(Span<const unsigned char> sig, Span<const unsigned char> pubkey, ScriptExecutionData& execdata, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror, bool& success)
 {
     assert(sigversion == SigVersion::TAPSCRIPT);
 
@@ -413,7 +465,7 @@ static bool EvalChecksigTapscript(const valtype& sig, const valtype& pubkey, Scr
  * A return value of false means the script fails entirely. When true is returned, the
  * success variable indicates whether the signature check itself succeeded.
  */
-static bool EvalChecksig(const valtype& sig, const valtype& pubkey, CScript::const_iterator pbegincodehash, CScript::const_iterator pend, ScriptExecutionData& execdata, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror, bool& success)
+static bool EvalChecksig(Span<const unsigned char> sig, Span<const unsigned char> pubkey, CScript::const_iterator pbegincodehash, CScript::const_iterator pend, ScriptExecutionData& execdata, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror, bool& success)
 {
     switch (sigversion) {
     case SigVersion::BASE:
@@ -428,47 +480,43 @@ static bool EvalChecksig(const valtype& sig, const valtype& pubkey, CScript::con
     assert(false);
 }
 
-bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptExecutionData& execdata, ScriptError* serror)
+/** Execute script, as decoded into decoded. Callers check MAX_SCRIPT_SIZE before decoding. */
+static bool EvalScript(Stack& stack, const CScript& script, const DecodedScript& decoded, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptExecutionData& execdata, ScriptError* serror)
 {
     static const CScriptNum bnZero(0);
     static const CScriptNum bnOne(1);
     // static const CScriptNum bnFalse(0);
     // static const CScriptNum bnTrue(1);
-    static const valtype vchFalse(0);
-    // static const valtype vchZero(0);
-    static const valtype vchTrue(1, 1);
+    static const StackElement vchFalse(0);
+    // static const StackElement vchZero(0);
+    static const StackElement vchTrue(1, uint8_t{1});
 
     // sigversion cannot be TAPROOT here, as it admits no script execution.
     assert(sigversion == SigVersion::BASE || sigversion == SigVersion::WITNESS_V0 || sigversion == SigVersion::TAPSCRIPT);
 
-    CScript::const_iterator pc = script.begin();
     CScript::const_iterator pend = script.end();
     CScript::const_iterator pbegincodehash = script.begin();
-    opcodetype opcode;
-    valtype vchPushValue;
     ConditionStack vfExec;
-    std::vector<valtype> altstack;
+    Stack altstack;
     set_error(serror, SCRIPT_ERR_UNKNOWN_ERROR);
-    if ((sigversion == SigVersion::BASE || sigversion == SigVersion::WITNESS_V0) && script.size() > MAX_SCRIPT_SIZE) {
-        return set_error(serror, SCRIPT_ERR_SCRIPT_SIZE);
-    }
     int nOpCount = 0;
     bool fRequireMinimal = (flags & SCRIPT_VERIFY_MINIMALDATA) != 0;
-    uint32_t opcode_pos = 0;
     execdata.m_codeseparator_pos = 0xFFFFFFFFUL;
     execdata.m_codeseparator_pos_init = true;
 
     try
     {
-        for (; pc < pend; ++opcode_pos) {
+        for (uint32_t opcode_pos = 0; opcode_pos < decoded.ops.size(); ++opcode_pos) {
+            const DecodedOp& op = decoded.ops[opcode_pos];
             bool fExec = vfExec.all_true();
 
             //
             // Read instruction
             //
-            if (!script.GetOp(pc, opcode, vchPushValue))
-                return set_error(serror, SCRIPT_ERR_BAD_OPCODE);
-            if (vchPushValue.size() > MAX_SCRIPT_ELEMENT_SIZE)
+            const opcodetype opcode = op.opcode;
+            const CScript::const_iterator pc = script.begin() + op.next;
+            const Span<const unsigned char> push_value{script.data() + op.data_begin, op.next - op.data_begin};
+            if (push_value.size() > MAX_SCRIPT_ELEMENT_SIZE)
                 return set_error(serror, SCRIPT_ERR_PUSH_SIZE);
 
             if (sigversion == SigVersion::BASE || sigversion == SigVersion::WITNESS_V0) {
@@ -500,10 +548,10 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 return set_error(serror, SCRIPT_ERR_OP_CODESEPARATOR);
 
             if (fExec && 0 <= opcode && opcode <= OP_PUSHDATA4) {
-                if (fRequireMinimal && !CheckMinimalPush(vchPushValue, opcode)) {
+                if (fRequireMinimal && !CheckMinimalPush(push_value, opcode)) {
                     return set_error(serror, SCRIPT_ERR_MINIMALDATA);
                 }
-                stack.push_back(vchPushValue);
+                stack.emplace_back(push_value.begin(), push_value.end());
             } else if (fExec || (OP_IF <= opcode && opcode <= OP_ENDIF))
             switch (opcode)
             {
@@ -530,7 +578,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 {
                     // ( -- value)
                     CScriptNum bn((int)opcode - (int)(OP_1 - 1));
-                    stack.push_back(bn.getvch());
+                    stack.push_back(bn.getvch<StackElement>());
                     // The result of these opcodes should always be the minimal way to push the data
                     // they push, so no need for a CheckMinimalPush here.
                 }
@@ -633,7 +681,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     {
                         if (stack.size() < 1)
                             return set_error(serror, SCRIPT_ERR_UNBALANCED_CONDITIONAL);
-                        valtype& vch = stacktop(-1);
+                        StackElement& vch = stacktop(-1);
                         // Tapscript requires minimal IF/NOTIF inputs as a consensus rule.
                         if (sigversion == SigVersion::TAPSCRIPT) {
                             // The input argument to the OP_IF and OP_NOTIF opcodes must be either
@@ -731,8 +779,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 -- x1 x2 x1 x2)
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch1 = stacktop(-2);
-                    valtype vch2 = stacktop(-1);
+                    StackElement vch1 = stacktop(-2);
+                    StackElement vch2 = stacktop(-1);
                     stack.push_back(vch1);
                     stack.push_back(vch2);
                 }
@@ -743,9 +791,9 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 x3 -- x1 x2 x3 x1 x2 x3)
                     if (stack.size() < 3)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch1 = stacktop(-3);
-                    valtype vch2 = stacktop(-2);
-                    valtype vch3 = stacktop(-1);
+                    StackElement vch1 = stacktop(-3);
+                    StackElement vch2 = stacktop(-2);
+                    StackElement vch3 = stacktop(-1);
                     stack.push_back(vch1);
                     stack.push_back(vch2);
                     stack.push_back(vch3);
@@ -757,8 +805,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 x3 x4 -- x1 x2 x3 x4 x1 x2)
                     if (stack.size() < 4)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch1 = stacktop(-4);
-                    valtype vch2 = stacktop(-3);
+                    StackElement vch1 = stacktop(-4);
+                    StackElement vch2 = stacktop(-3);
                     stack.push_back(vch1);
                     stack.push_back(vch2);
                 }
@@ -769,8 +817,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 x3 x4 x5 x6 -- x3 x4 x5 x6 x1 x2)
                     if (stack.size() < 6)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch1 = stacktop(-6);
-                    valtype vch2 = stacktop(-5);
+                    StackElement vch1 = stacktop(-6);
+                    StackElement vch2 = stacktop(-5);
                     stack.erase(stack.end()-6, stack.end()-4);
                     stack.push_back(vch1);
                     stack.push_back(vch2);
@@ -782,8 +830,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 x3 x4 -- x3 x4 x1 x2)
                     if (stack.size() < 4)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    swap(stacktop(-4), stacktop(-2));
-                    swap(stacktop(-3), stacktop(-1));
+                    std::swap(stacktop(-4), stacktop(-2));
+                    std::swap(stacktop(-3), stacktop(-1));
                 }
                 break;
 
@@ -792,7 +840,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x - 0 | x x)
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-1);
+                    StackElement vch = stacktop(-1);
                     if (CastToBool(vch))
                         stack.push_back(vch);
                 }
@@ -802,7 +850,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 {
                     // -- stacksize
                     CScriptNum bn(stack.size());
-                    stack.push_back(bn.getvch());
+                    stack.push_back(bn.getvch<StackElement>());
                 }
                 break;
 
@@ -820,7 +868,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x -- x x)
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-1);
+                    StackElement vch = stacktop(-1);
                     stack.push_back(vch);
                 }
                 break;
@@ -839,7 +887,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 -- x1 x2 x1)
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-2);
+                    StackElement vch = stacktop(-2);
                     stack.push_back(vch);
                 }
                 break;
@@ -855,7 +903,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     popstack(stack);
                     if (n < 0 || n >= (int)stack.size())
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-n-1);
+                    StackElement vch = stacktop(-n-1);
                     if (opcode == OP_ROLL)
                         stack.erase(stack.end()-n-1);
                     stack.push_back(vch);
@@ -869,8 +917,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     //  x2 x3 x1  after second swap
                     if (stack.size() < 3)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    swap(stacktop(-3), stacktop(-2));
-                    swap(stacktop(-2), stacktop(-1));
+                    std::swap(stacktop(-3), stacktop(-2));
+                    std::swap(stacktop(-2), stacktop(-1));
                 }
                 break;
 
@@ -879,7 +927,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 -- x2 x1)
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    swap(stacktop(-2), stacktop(-1));
+                    std::swap(stacktop(-2), stacktop(-1));
                 }
                 break;
 
@@ -888,7 +936,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 -- x2 x1 x2)
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-1);
+                    StackElement vch = stacktop(-1);
                     stack.insert(stack.end()-2, vch);
                 }
                 break;
@@ -900,7 +948,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
                     CScriptNum bn(stacktop(-1).size());
-                    stack.push_back(bn.getvch());
+                    stack.push_back(bn.getvch<StackElement>());
                 }
                 break;
 
@@ -915,8 +963,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 - bool)
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype& vch1 = stacktop(-2);
-                    valtype& vch2 = stacktop(-1);
+                    StackElement& vch1 = stacktop(-2);
+                    StackElement& vch2 = stacktop(-1);
                     bool fEqual = (vch1 == vch2);
                     // OP_NOTEQUAL is disabled because it would be too easy to say
                     // something like n != 1 and have some wiseguy pass in 1 with extra
@@ -962,7 +1010,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     default:            assert(!"invalid opcode"); break;
                     }
                     popstack(stack);
-                    stack.push_back(bn.getvch());
+                    stack.push_back(bn.getvch<StackElement>());
                 }
                 break;
 
@@ -1011,7 +1059,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     }
                     popstack(stack);
                     popstack(stack);
-                    stack.push_back(bn.getvch());
+                    stack.push_back(bn.getvch<StackElement>());
 
                     if (opcode == OP_NUMEQUALVERIFY)
                     {
@@ -1052,8 +1100,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (in -- hash)
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype& vch = stacktop(-1);
-                    valtype vchHash((opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32);
+                    StackElement& vch = stacktop(-1);
+                    StackElement vchHash((opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32);
                     if (opcode == OP_RIPEMD160)
                         CRIPEMD160().Write(vch.data(), vch.size()).Finalize(vchHash.data());
                     else if (opcode == OP_SHA1)
@@ -1087,8 +1135,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
 
-                    valtype& vchSig    = stacktop(-2);
-                    valtype& vchPubKey = stacktop(-1);
+                    StackElement& vchSig    = stacktop(-2);
+                    StackElement& vchPubKey = stacktop(-1);
 
                     bool fSuccess = true;
                     if (!EvalChecksig(vchSig, vchPubKey, pbegincodehash, pend, execdata, flags, checker, sigversion, serror, fSuccess)) return false;
@@ -1113,16 +1161,16 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (sig num pubkey -- num)
                     if (stack.size() < 3) return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
 
-                    const valtype& sig = stacktop(-3);
+                    const StackElement& sig = stacktop(-3);
                     const CScriptNum num(stacktop(-2), fRequireMinimal);
-                    const valtype& pubkey = stacktop(-1);
+                    const StackElement& pubkey = stacktop(-1);
 
                     bool success = true;
                     if (!EvalChecksig(sig, pubkey, pbegincodehash, pend, execdata, flags, checker, sigversion, serror, success)) return false;
                     popstack(stack);
                     popstack(stack);
                     popstack(stack);
-                    stack.push_back((num + (success ? 1 : 0)).getvch());
+                    stack.push_back((num + (success ? 1 : 0)).getvch<StackElement>());
                 }
                 break;
 
@@ -1165,9 +1213,9 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // Drop the signature in pre-segwit scripts but not segwit scripts
                     for (int k = 0; k < nSigsCount; k++)
                     {
-                        valtype& vchSig = stacktop(-isig-k);
+                        StackElement& vchSig = stacktop(-isig-k);
                         if (sigversion == SigVersion::BASE) {
-                            int found = FindAndDelete(scriptCode, CScript() << vchSig);
+                            int found = FindAndDelete(scriptCode, CScript() << valtype(vchSig.begin(), vchSig.end()));
                             if (found > 0 && (flags & SCRIPT_VERIFY_CONST_SCRIPTCODE))
                                 return set_error(serror, SCRIPT_ERR_SIG_FINDANDDELETE);
                         }
@@ -1176,8 +1224,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     bool fSuccess = true;
                     while (fSuccess && nSigsCount > 0)
                     {
-                        valtype& vchSig    = stacktop(-isig);
-                        valtype& vchPubKey = stacktop(-ikey);
+                        StackElement& vchSig    = stacktop(-isig);
+                        StackElement& vchPubKey = stacktop(-ikey);
 
                         // Note how this makes the exact order of pubkey/signature evaluation
                         // distinguishable by CHECKMULTISIG NOT if the STRICTENC flag is set.
@@ -1246,6 +1294,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
             if (stack.size() + altstack.size() > MAX_STACK_SIZE)
                 return set_error(serror, SCRIPT_ERR_STACK_SIZE);
         }
+        if (decoded.invalid)
+            return set_error(serror, SCRIPT_ERR_BAD_OPCODE);
     }
     catch (...)
     {
@@ -1258,6 +1308,26 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
     return set_success(serror);
 }
 
+static bool EvalScript(Stack& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptExecutionData& execdata, ScriptError* serror)
+{
+    // Reject oversized scripts before spending any effort on decoding them.
+    if ((sigversion == SigVersion::BASE || sigversion == SigVersion::WITNESS_V0) && script.size() > MAX_SCRIPT_SIZE) {
+        return set_error(serror, SCRIPT_ERR_SCRIPT_SIZE);
+    }
+    return EvalScript(stack, script, DecodedScript(script), flags, checker, sigversion, execdata, serror);
+}
+
+bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptExecutionData& execdata, ScriptError* serror)
+{
+    Stack eval_stack;
+    eval_stack.reserve(stack.size());
+    for (const valtype& elem : stack) eval_stack.emplace_back(elem.begin(), elem.end());
+    const bool ret{EvalScript(eval_stack, script, flags, checker, sigversion, execdata, serror)};
+    stack.clear();
+    for (const StackElement& elem : eval_stack) stack.emplace_back(elem.begin(), elem.end());
+    return ret;
+}
+
 bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
 {
     ScriptExecutionData execdata;
@@ -1416,11 +1486,59 @@ uint256 GetSpentScriptsSHA256(const std::vector<CTxOut>& outputs_spent)
     return ss.GetSHA256();
 }
 
+/** Compute the start of the BIP143 signature hash, up to the input being signed. */
+template <class T>
+CHashWriter BIP143Preamble(const T& txTo, const uint256& hashPrevouts, const uint256& hashSequence)
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    // Version
+    ss << txTo.nVersion;
+    // Input prevouts/nSequence (none/all, depending on flags)
+    ss << hashPrevouts;
+    ss << hashSequence;
+    return ss;
+}
 
 } // namespace
 
+static const CHashWriter HASHER_TAPSIGHASH = TaggedHash("TapSighash");
+static const CHashWriter HASHER_TAPLEAF = TaggedHash("TapLeaf");
+static const CHashWriter HASHER_TAPBRANCH = TaggedHash("TapBranch");
+static const CHashWriter HASHER_TAPTWEAK = TaggedHash("TapTweak");
+
+/** Compute the start of the BIP341 signature hash, up to the data about the input being signed. */
+template <class T>
+static CHashWriter BIP341Preamble(const T& tx_to, uint8_t hash_type, const PrecomputedTransactionData& cache)
+{
+    const uint8_t output_type = (hash_type == SIGHASH_DEFAULT) ? SIGHASH_ALL : (hash_type & SIGHASH_OUTPUT_MASK); // Default (no sighash byte) is equivalent to SIGHASH_ALL
+    const uint8_t input_type = hash_type & SIGHASH_INPUT_MASK;
+
+    CHashWriter ss = HASHER_TAPSIGHASH;
+
+    // Epoch
+    static constexpr uint8_t EPOCH = 0;
+    ss << EPOCH;
+
+    // Hash type
+    ss << hash_type;
+
+    // Transaction level data
+    ss << tx_to.nVersion;
+    ss << tx_to.nLockTime;
+    if (input_type != SIGHASH_ANYONECANPAY) {
+        ss << cache.m_prevouts_single_hash;
+        ss << cache.m_spent_amounts_single_hash;
+        ss << cache.m_spent_scripts_single_hash;
+        ss << cache.m_sequences_single_hash;
+    }
+    if (output_type == SIGHASH_ALL) {
+        ss << cache.m_outputs_single_hash;
+    }
+    return ss;
+}
+
 template <class T>
-void PrecomputedTransactionData::Init(const T& txTo, std::vector<CTxOut>&& spent_outputs)
+void PrecomputedTransactionData::Init(const T& txTo, std::vector<CTxOut>&& spent_outputs, bool force)
 {
     assert(!m_spent_outputs_ready);
 
@@ -1431,10 +1549,16 @@ void PrecomputedTransactionData::Init(const T& txTo, std::vector<CTxOut>&& spent
     }
 
     // Determine which precomputation-impacting features this transaction uses.
-    bool uses_bip143_segwit = false;
-    bool uses_bip341_taproot = false;
+    bool uses_bip143_segwit = force;
+    bool uses_bip341_taproot = force && m_spent_outputs_ready;
+    // Number of inputs that will likely use the BIP143 preamble, and number of Taproot key
+    // path spends using SIGHASH_DEFAULT and SIGHASH_ALL. When forced, assume all inputs do.
+    const size_t forced_inputs = force ? txTo.vin.size() : 0;
+    size_t bip143_inputs = forced_inputs;
+    size_t bip341_keypath_inputs[2] = {forced_inputs, forced_inputs};
     for (size_t inpos = 0; inpos < txTo.vin.size(); ++inpos) {
-        if (!txTo.vin[inpos].scriptWitness.IsNull()) {
+        const auto& stack = txTo.vin[inpos].scriptWitness.stack;
+        if (!stack.empty()) {
             if (m_spent_outputs_ready && m_spent_outputs[inpos].scriptPubKey.size() == 2 + WITNESS_V1_TAPROOT_SIZE &&
                 m_spent_outputs[inpos].scriptPubKey[0] == OP_1) {
                 // Treat every witness-bearing spend with 34-byte scriptPubKey that starts with OP_1 as a Taproot
@@ -1442,14 +1566,24 @@ void PrecomputedTransactionData::Init(const T& txTo, std::vector<CTxOut>&& spent
                 // will fail anyway. Note that this branch may trigger for scriptPubKeys that aren't actually segwit
                 // but in that case validation will fail as SCRIPT_ERR_WITNESS_UNEXPECTED anyway.
                 uses_bip341_taproot = true;
+                // The hash type of key path spends (one stack element after removing the annex) is known.
+                const bool has_annex = stack.size() >= 2 && !stack.back().empty() && stack.back()[0] == ANNEX_TAG;
+                if (stack.size() - has_annex == 1) {
+                    const auto& sig = stack.front();
+                    if (sig.size() == 64) {
+                        ++bip341_keypath_inputs[SIGHASH_DEFAULT];
+                    } else if (sig.size() == 65 && sig.back() == SIGHASH_ALL) {
+                        ++bip341_keypath_inputs[SIGHASH_ALL];
+                    }
+                }
             } else {
                 // Treat every spend that's not known to native witness v1 as a Witness v0 spend. This branch may
                 // also be taken for unknown witness versions, but it is harmless, and being precise would require
                 // P2SH evaluation to find the redeemScript.
                 uses_bip143_segwit = true;
+                ++bip143_inputs;
             }
         }
-        if (uses_bip341_taproot && uses_bip143_segwit) break; // No need to scan further if we already need all.
     }
 
     if (uses_bip143_segwit || uses_bip341_taproot) {
@@ -1458,16 +1592,22 @@ void PrecomputedTransactionData::Init(const T& txTo, std::vector<CTxOut>&& spent
         m_sequences_single_hash = GetSequencesSHA256(txTo);
         m_outputs_single_hash = GetOutputsSHA256(txTo);
     }
+    // Computing a signature hash preamble costs about as much as using it once saves, so they
+    // are only computed when multiple inputs will use them.
     if (uses_bip143_segwit) {
         hashPrevouts = SHA256Uint256(m_prevouts_single_hash);
         hashSequence = SHA256Uint256(m_sequences_single_hash);
         hashOutputs = SHA256Uint256(m_outputs_single_hash);
         m_bip143_segwit_ready = true;
+        if (bip143_inputs >= 2) m_bip143_preamble.emplace(BIP143Preamble(txTo, hashPrevouts, hashSequence));
     }
     if (uses_bip341_taproot) {
         m_spent_amounts_single_hash = GetSpentAmountsSHA256(m_spent_outputs);
         m_spent_scripts_single_hash = GetSpentScriptsSHA256(m_spent_outputs);
         m_bip341_taproot_ready = true;
+        for (uint8_t hash_type : {SIGHASH_DEFAULT, SIGHASH_ALL}) {
+            if (bip341_keypath_inputs[hash_type] >= 2) m_bip341_preambles[hash_type].emplace(BIP341Preamble(txTo, hash_type, *this));
+        }
     }
 }
 
@@ -1478,16 +1618,11 @@ PrecomputedTransactionData::PrecomputedTransactionData(const T& txTo)
 }
 
 // explicit instantiation
-template void PrecomputedTransactionData::Init(const CTransaction& txTo, std::vector<CTxOut>&& spent_outputs);
-template void PrecomputedTransactionData::Init(const CMutableTransaction& txTo, std::vector<CTxOut>&& spent_outputs);
+template void PrecomputedTransactionData::Init(const CTransaction& txTo, std::vector<CTxOut>&& spent_outputs, bool force);
+template void PrecomputedTransactionData::Init(const CMutableTransaction& txTo, std::vector<CTxOut>&& spent_outputs, bool force);
 template PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo);
 template PrecomputedTransactionData::PrecomputedTransactionData(const CMutableTransaction& txTo);
 
-static const CHashWriter HASHER_TAPSIGHASH = TaggedHash("TapSighash");
-static const CHashWriter HASHER_TAPLEAF = TaggedHash("TapLeaf");
-static const CHashWriter HASHER_TAPBRANCH = TaggedHash("TapBranch");
-static const CHashWriter HASHER_TAPTWEAK = TaggedHash("TapTweak");
-
 template<typename T>
 bool SignatureHashSchnorr(uint256& hash_out, const ScriptExecutionData& execdata, const T& tx_to, uint32_t in_pos, uint8_t hash_type, SigVersion sigversion, const PrecomputedTransactionData& cache)
 {
@@ -1511,30 +1646,11 @@ bool SignatureHashSchnorr(uint256& hash_out, const ScriptExecutionData& execdata
     assert(in_pos < tx_to.vin.size());
     assert(cache.m_bip341_taproot_ready && cache.m_spent_outputs_ready);
 
-    CHashWriter ss = HASHER_TAPSIGHASH;
-
-    // Epoch
-    static constexpr uint8_t EPOCH = 0;
-    ss << EPOCH;
-
-    // Hash type
+    // Epoch, hash type and transaction level data
     const uint8_t output_type = (hash_type == SIGHASH_DEFAULT) ? SIGHASH_ALL : (hash_type & SIGHASH_OUTPUT_MASK); // Default (no sighash byte) is equivalent to SIGHASH_ALL
     const uint8_t input_type = hash_type & SIGHASH_INPUT_MASK;
     if (!(hash_type <= 0x03 || (hash_type >= 0x81 && hash_type <= 0x83))) return false;
-    ss << hash_type;
-
-    // Transaction level data
-    ss << tx_to.nVersion;
-    ss << tx_to.nLockTime;
-    if (input_type != SIGHASH_ANYONECANPAY) {
-        ss << cache.m_prevouts_single_hash;
-        ss << cache.m_spent_amounts_single_hash;
-        ss << cache.m_spent_scripts_single_hash;
-        ss << cache.m_sequences_single_hash;
-    }
-    if (output_type == SIGHASH_ALL) {
-        ss << cache.m_outputs_single_hash;
-    }
+    CHashWriter ss = hash_type < cache.m_bip341_preambles.size() && cache.m_bip341_preambles[hash_type] ? *cache.m_bip341_preambles[hash_type] : BIP341Preamble(tx_to, hash_type, cache);
 
     // Data about the input/prevout being spent
     assert(execdata.m_annex_init);
@@ -1573,6 +1689,10 @@ bool SignatureHashSchnorr(uint256& hash_out, const ScriptExecutionData& execdata
     return true;
 }
 
+// explicit instantiation
+template bool SignatureHashSchnorr(uint256& hash_out, const ScriptExecutionData& execdata, const CTransaction& tx_to, uint32_t in_pos, uint8_t hash_type, SigVersion sigversion, const PrecomputedTransactionData& cache);
+template bool SignatureHashSchnorr(uint256& hash_out, const ScriptExecutionData& execdata, const CMutableTransaction& tx_to, uint32_t in_pos, uint8_t hash_type, SigVersion sigversion, const PrecomputedTransactionData& cache);
+
 template <class T>
 uint256 SignatureHash(const CScript& scriptCode, const T& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, const PrecomputedTransactionData* cache)
 {
@@ -1601,12 +1721,9 @@ uint256 SignatureHash(const CScript& scriptCode, const T& txTo, unsigned int nIn
             hashOutputs = ss.GetHash();
         }
 
-        CHashWriter ss(SER_GETHASH, 0);
-        // Version
-        ss << txTo.nVersion;
-        // Input prevouts/nSequence (none/all, depending on flags)
-        ss << hashPrevouts;
-        ss << hashSequence;
+        // Version and input prevouts/nSequence (none/all, depending on flags)
+        const bool all_inputs = !(nHashType & SIGHASH_ANYONECANPAY) && (nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE;
+        CHashWriter ss = all_inputs && cacheready && cache->m_bip143_preamble ? *cache->m_bip143_preamble : BIP143Preamble(txTo, hashPrevouts, hashSequence);
         // The input being signed (replacing the scriptSig with scriptCode + amount)
         // The prevout may already be contained in hashPrevout, and the nSequence
         // may already be contain in hashSequence.
@@ -1654,14 +1771,14 @@ bool GenericTransactionSignatureChecker<T>::VerifySchnorrSignature(Span<const un
 }
 
 template <class T>
-bool GenericTransactionSignatureChecker<T>::CheckECDSASignature(const std::vector<unsigned char>& vchSigIn, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion) const
+bool GenericTransactionSignatureChecker<T>::CheckECDSASignature(Span<const unsigned char> vchSigIn, Span<const unsigned char> vchPubKey, const CScript& scriptCode, SigVersion sigversion) const
 {
-    CPubKey pubkey(vchPubKey);
+    CPubKey pubkey(vchPubKey.begin(), vchPubKey.end());
     if (!pubkey.IsValid())
         return false;
 
     // Hash type is one byte tacked on to the end of the signature
-    std::vector<unsigned char> vchSig(vchSigIn);
+    std::vector<unsigned char> vchSig(vchSigIn.begin(), vchSigIn.end());
     if (vchSig.empty())
         return false;
     int nHashType = vchSig.back();
@@ -1793,37 +1910,46 @@ template class GenericTransactionSignatureChecker<CMutableTransaction>;
 
 static bool ExecuteWitnessScript(const Span<const valtype>& stack_span, const CScript& scriptPubKey, unsigned int flags, SigVersion sigversion, const BaseSignatureChecker& checker, ScriptExecutionData& execdata, ScriptError* serror)
 {
-    std::vector<valtype> stack{stack_span.begin(), stack_span.end()};
+    // Tapscripts are decoded up front to look for OP_SUCCESSx. Other scripts
+    // are decoded by EvalScript, after their size is checked.
+    std::optional<DecodedScript> decoded;
 
     if (sigversion == SigVersion::TAPSCRIPT) {
+        decoded.emplace(scriptPubKey);
         // OP_SUCCESSx processing overrides everything, including stack element size limits
-        CScript::const_iterator pc = scriptPubKey.begin();
-        while (pc < scriptPubKey.end()) {
-            opcodetype opcode;
-            if (!scriptPubKey.GetOp(pc, opcode)) {
-                // Note how this condition would not be reached if an unknown OP_SUCCESSx was found
-                return set_error(serror, SCRIPT_ERR_BAD_OPCODE);
-            }
+        for (const DecodedOp& op : decoded->ops) {
             // New opcodes will be listed here. May use a different sigversion to modify existing opcodes.
-            if (IsOpSuccess(opcode)) {
+            if (IsOpSuccess(op.opcode)) {
                 if (flags & SCRIPT_VERIFY_DISCOURAGE_OP_SUCCESS) {
                     return set_error(serror, SCRIPT_ERR_DISCOURAGE_OP_SUCCESS);
                 }
                 return set_success(serror);
             }
         }
+        if (decoded->invalid) {
+            // Note how this condition would not be reached if an unknown OP_SUCCESSx was found
+            return set_error(serror, SCRIPT_ERR_BAD_OPCODE);
+        }
 
         // Tapscript enforces initial stack size limits (altstack is empty here)
-        if (stack.size() > MAX_STACK_SIZE) return set_error(serror, SCRIPT_ERR_STACK_SIZE);
+        if (stack_span.size() > MAX_STACK_SIZE) return set_error(serror, SCRIPT_ERR_STACK_SIZE);
     }
 
     // Disallow stack item size > MAX_SCRIPT_ELEMENT_SIZE in witness stack
-    for (const valtype& elem : stack) {
+    for (const valtype& elem : stack_span) {
         if (elem.size() > MAX_SCRIPT_ELEMENT_SIZE) return set_error(serror, SCRIPT_ERR_PUSH_SIZE);
     }
 
+    Stack stack;
+    stack.reserve(stack_span.size());
+    for (const valtype& elem : stack_span) stack.emplace_back(elem.begin(), elem.end());
+
     // Run the script interpreter.
-    if (!EvalScript(stack, scriptPubKey, flags, checker, sigversion, execdata, serror)) return false;
+    if (decoded) {
+        if (!EvalScript(stack, scriptPubKey, *decoded, flags, checker, sigversion, execdata, serror)) return false;
+    } else {
+        if (!EvalScript(stack, scriptPubKey, flags, checker, sigversion, execdata, serror)) return false;
+    }
 
     // Scripts inside witness implicitly require cleanstack behaviour
     if (stack.size() != 1) return set_error(serror, SCRIPT_ERR_CLEANSTACK);
@@ -1940,7 +2066,114 @@ static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion,
     // There is intentionally no return statement here, to be able to use "control reaches end of non-void function" warnings to detect gaps in the logic above.
 }
 
+/** Verify a P2PKH spend: <sig> <pubkey> | OP_DUP OP_HASH160 <hash> OP_EQUALVERIFY OP_CHECKSIG. */
+static std::optional<bool> VerifyP2PKH(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness& witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    if (scriptSig.size() > MAX_SCRIPT_SIZE) return std::nullopt;
+    const DecodedScript decoded(scriptSig);
+    if (decoded.invalid || decoded.ops.size() != 2) return std::nullopt;
+    Span<const unsigned char> pushes[2];
+    for (size_t i = 0; i < 2; ++i) {
+        const DecodedOp& op = decoded.ops[i];
+        if (op.opcode > OP_PUSHDATA4) return std::nullopt;
+        pushes[i] = Span<const unsigned char>{scriptSig.data() + op.data_begin, op.next - op.data_begin};
+        if (pushes[i].size() > MAX_SCRIPT_ELEMENT_SIZE) return set_error(serror, SCRIPT_ERR_PUSH_SIZE);
+        if ((flags & SCRIPT_VERIFY_MINIMALDATA) && !CheckMinimalPush(pushes[i], op.opcode)) return set_error(serror, SCRIPT_ERR_MINIMALDATA);
+    }
+    const Span<const unsigned char> sig = pushes[0], pubkey = pushes[1];
+
+    uint160 pubkey_hash;
+    CHash160().Write(pubkey).Finalize(pubkey_hash);
+    if (memcmp(pubkey_hash.begin(), scriptPubKey.data() + 3, 20)) return set_error(serror, SCRIPT_ERR_EQUALVERIFY);
+
+    bool success;
+    if (!EvalChecksigPreTapscript(sig, pubkey, scriptPubKey.begin(), scriptPubKey.end(), flags, checker, SigVersion::BASE, serror, success)) {
+        return false; // serror is set
+    }
+    if (!success) return set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+    if (!witness.IsNull()) return set_error(serror, SCRIPT_ERR_WITNESS_UNEXPECTED);
+    return set_success(serror);
+}
+
+/** Verify a P2WPKH spend: an empty scriptSig, OP_0 <hash>, and a witness of <sig> <pubkey>. */
+static std::optional<bool> VerifyP2WPKH(const CScript& scriptPubKey, const CScriptWitness& witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    const Span<const unsigned char> program{scriptPubKey.data() + 2, WITNESS_V0_KEYHASH_SIZE};
+    if (!CastToBool(program)) return set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+    if (witness.stack.size() != 2) return set_error(serror, SCRIPT_ERR_WITNESS_PROGRAM_MISMATCH);
+    const valtype& sig = witness.stack[0];
+    const valtype& pubkey = witness.stack[1];
+    if (sig.size() > MAX_SCRIPT_ELEMENT_SIZE || pubkey.size() > MAX_SCRIPT_ELEMENT_SIZE) return set_error(serror, SCRIPT_ERR_PUSH_SIZE);
+
+    uint160 pubkey_hash;
+    CHash160().Write(pubkey).Finalize(pubkey_hash);
+    if (memcmp(pubkey_hash.begin(), program.data(), 20)) return set_error(serror, SCRIPT_ERR_EQUALVERIFY);
+
+    // The implied script is the P2PKH script of the program, which fits in CScript's inline buffer.
+    CScript script_code;
+    script_code << OP_DUP << OP_HASH160 << valtype(program.begin(), program.end()) << OP_EQUALVERIFY << OP_CHECKSIG;
+    bool success;
+    if (!EvalChecksigPreTapscript(sig, pubkey, script_code.begin(), script_code.end(), flags, checker, SigVersion::WITNESS_V0, serror, success)) {
+        return false; // serror is set
+    }
+    if (!success) return set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+    return set_success(serror);
+}
+
+/** Verify a P2TR key path spend without annex: an empty scriptSig, OP_1 <pubkey>, and a witness of <sig>. */
+static std::optional<bool> VerifyP2TRKeyPath(const CScript& scriptPubKey, const CScriptWitness& witness, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    const Span<const unsigned char> program{scriptPubKey.data() + 2, WITNESS_V1_TAPROOT_SIZE};
+    if (!CastToBool(program)) return set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+
+    ScriptExecutionData execdata;
+    execdata.m_annex_present = false;
+    execdata.m_annex_init = true;
+    // The generic path has successfully evaluated the scriptPubKey at this point.
+    set_success(serror);
+    if (!checker.CheckSchnorrSignature(witness.stack[0], program, SigVersion::TAPROOT, execdata, serror)) {
+        return false; // serror is set
+    }
+    return set_success(serror);
+}
+
+/**
+ * Verify spends of the most common output types directly, without running the
+ * script interpreter. Returns std::nullopt if the spend doesn't match one of
+ * these templates, and otherwise the same result and error as VerifyScriptGeneric.
+ */
+static std::optional<bool> VerifyStandardTemplate(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness& witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    // Only consider the flags used for (nearly) all blocks and for policy.
+    if ((flags & (SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS)) != (SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS)) return std::nullopt;
+
+    const size_t size = scriptPubKey.size();
+    if (size == 25 && scriptPubKey[0] == OP_DUP && scriptPubKey[1] == OP_HASH160 && scriptPubKey[2] == 20 &&
+        scriptPubKey[23] == OP_EQUALVERIFY && scriptPubKey[24] == OP_CHECKSIG) {
+        return VerifyP2PKH(scriptSig, scriptPubKey, witness, flags, checker, serror);
+    }
+    if (!scriptSig.empty()) return std::nullopt;
+    if (size == 2 + WITNESS_V0_KEYHASH_SIZE && scriptPubKey[0] == OP_0 && scriptPubKey[1] == WITNESS_V0_KEYHASH_SIZE) {
+        return VerifyP2WPKH(scriptPubKey, witness, flags, checker, serror);
+    }
+    if (size == 2 + WITNESS_V1_TAPROOT_SIZE && scriptPubKey[0] == OP_1 && scriptPubKey[1] == WITNESS_V1_TAPROOT_SIZE &&
+        (flags & SCRIPT_VERIFY_TAPROOT) && witness.stack.size() == 1) {
+        return VerifyP2TRKeyPath(scriptPubKey, witness, checker, serror);
+    }
+    return std::nullopt;
+}
+
 bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    static const CScriptWitness emptyWitness;
+    set_error(serror, SCRIPT_ERR_UNKNOWN_ERROR);
+    if (auto result = VerifyStandardTemplate(scriptSig, scriptPubKey, witness ? *witness : emptyWitness, flags, checker, serror)) {
+        return *result;
+    }
+    return VerifyScriptGeneric(scriptSig, scriptPubKey, witness, flags, checker, serror);
+}
+
+bool VerifyScriptGeneric(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
 {
     static const CScriptWitness emptyWitness;
     if (witness == nullptr) {
@@ -1956,13 +2189,14 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
 
     // scriptSig and scriptPubKey must be evaluated sequentially on the same stack
     // rather than being simply concatenated (see CVE-2010-5141)
-    std::vector<std::vector<unsigned char> > stack, stackCopy;
-    if (!EvalScript(stack, scriptSig, flags, checker, SigVersion::BASE, serror))
+    Stack stack, stackCopy;
+    ScriptExecutionData execdata;
+    if (!EvalScript(stack, scriptSig, flags, checker, SigVersion::BASE, execdata, serror))
         // serror is set
         return false;
     if (flags & SCRIPT_VERIFY_P2SH)
         stackCopy = stack;
-    if (!EvalScript(stack, scriptPubKey, flags, checker, SigVersion::BASE, serror))
+    if (!EvalScript(stack, scriptPubKey, flags, checker, SigVersion::BASE, execdata, serror))
         // serror is set
         return false;
     if (stack.empty())
@@ -2004,11 +2238,11 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
         // an empty stack and the EvalScript above would return false.
         assert(!stack.empty());
 
-        const valtype& pubKeySerialized = stack.back();
-        CScript pubKey2(pubKeySerialized.begin(), pubKeySerialized.end());
+        const StackElement& pubKeySerialized = stack.back();
+        CScript pubKey2(pubKeySerialized.data(), pubKeySerialized.data() + pubKeySerialized.size());
         popstack(stack);
 
-        if (!EvalScript(stack, pubKey2, flags, checker, SigVersion::BASE, serror))
+        if (!EvalScript(stack, pubKey2, flags, checker, SigVersion::BASE, execdata, serror))
             // serror is set
             return false;
         if (stack.empty())
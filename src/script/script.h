@@ -9,6 +9,7 @@
 #include <crypto/common.h>
 #include <prevector.h>
 #include <serialize.h>
+#include <span.h>
 
 #include <assert.h>
 #include <climits>
@@ -234,7 +235,7 @@ public:
 
     static const size_t nDefaultMaxNumSize = 4;
 
-    explicit CScriptNum(const std::vector<unsigned char>& vch, bool fRequireMinimal,
+    explicit CScriptNum(Span<const unsigned char> vch, bool fRequireMinimal,
                         const size_t nMaxNumSize = nDefaultMaxNumSize)
     {
         if (vch.size() > nMaxNumSize) {
@@ -336,12 +337,25 @@ public:
         return serialize(m_value);
     }
 
+    /** Serialize into a byte container of type T, e.g. one that doesn't allocate. */
+    template <typename T>
+    T getvch() const
+    {
+        return serialize<T>(m_value);
+    }
+
     static std::vector<unsigned char> serialize(const int64_t& value)
+    {
+        return serialize<std::vector<unsigned char>>(value);
+    }
+
+    template <typename T>
+    static T serialize(const int64_t& value)
     {
         if(value == 0)
-            return std::vector<unsigned char>();
+            return T();
 
-        std::vector<unsigned char> result;
+        T result;
         const bool neg = value < 0;
         uint64_t absvalue = neg ? ~static_cast<uint64_t>(value) + 1 : static_cast<uint64_t>(value);
 
@@ -370,7 +384,7 @@ public:
     }
 
 private:
-    static int64_t set_vch(const std::vector<unsigned char>& vch)
+    static int64_t set_vch(Span<const unsigned char> vch)
     {
       if (vch.empty())
           return 0;
@@ -13,6 +13,46 @@
 #include <cuckoocache.h>
 #include <boost/thread/shared_mutex.hpp>
 
+struct alignas(64) ShardedCuckooCache::Shard {
+    boost::shared_mutex mutex;
+    CuckooCache::cache<uint256, SignatureCacheHasher> cache;
+};
+
+ShardedCuckooCache::ShardedCuckooCache() : m_shards(new Shard[SHARDS]) {}
+ShardedCuckooCache::~ShardedCuckooCache() = default;
+
+ShardedCuckooCache::Shard& ShardedCuckooCache::GetShard(const uint256& entry) const
+{
+    // Use the low bits of the first hash used by the cuckoo cache, which barely
+    // affect where in the shard's table the entry goes.
+    return m_shards[SignatureCacheHasher{}.operator()<0>(entry) % SHARDS];
+}
+
+size_t ShardedCuckooCache::setup_bytes(size_t bytes)
+{
+    size_t elems = 0;
+    for (size_t i = 0; i < SHARDS; ++i) {
+        boost::unique_lock<boost::shared_mutex> lock(m_shards[i].mutex);
+        elems += m_shards[i].cache.setup_bytes(bytes / SHARDS);
+    }
+    return elems;
+}
+
+void ShardedCuckooCache::insert(const uint256& entry)
+{
+    Shard& shard = GetShard(entry);
+    boost::unique_lock<boost::shared_mutex> lock(shard.mutex);
+    shard.cache.insert(entry);
+}
+
+bool ShardedCuckooCache::contains(const uint256& entry, bool erase) const
+{
+    Shard& shard = GetShard(entry);
+    // Erasing only sets an atomic flag, so it doesn't need an exclusive lock.
+    boost::shared_lock<boost::shared_mutex> lock(shard.mutex);
+    return shard.cache.contains(entry, erase);
+}
+
 namespace {
 /**
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
@@ -25,9 +65,7 @@ private:
      //! Entries are SHA256(nonce || 'E' or 'S' || 31 zero bytes || signature hash || public key || signature):
     CSHA256 m_salted_hasher_ecdsa;
     CSHA256 m_salted_hasher_schnorr;
-    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
-    map_type setValid;
-    boost::shared_mutex cs_sigcache;
+    ShardedCuckooCache setValid;
 
 public:
     CSignatureCache()
@@ -62,16 +100,14 @@ public:
     bool
     Get(const uint256& entry, const bool erase)
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
         return setValid.contains(entry, erase);
     }
 
     void Set(const uint256& entry)
     {
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
         setValid.insert(entry);
     }
-    uint32_t setup_bytes(size_t n)
+    size_t setup_bytes(size_t n)
     {
         return setValid.setup_bytes(n);
     }
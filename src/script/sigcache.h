@@ -9,6 +9,7 @@
 #include <script/interpreter.h>
 #include <span.h>
 
+#include <memory>
 #include <vector>
 
 // DoS prevention: limit cache size to 32MB (over 1000000 entries on 64-bit
@@ -41,6 +42,33 @@ public:
     }
 };
 
+/**
+ * A set of uint256 entries (salted hashes, see SignatureCacheHasher), split into
+ * shards which each have their own CuckooCache::cache and lock. Lookups only
+ * share a lock with lookups of the same shard, and inserts only block lookups
+ * of one shard, so that script check threads rarely wait for each other.
+ */
+class ShardedCuckooCache
+{
+    struct Shard;
+    std::unique_ptr<Shard[]> m_shards;
+
+    Shard& GetShard(const uint256& entry) const;
+
+public:
+    //! Number of shards, enough to make contention rare with the maximum number of script check threads.
+    static constexpr size_t SHARDS{64};
+
+    ShardedCuckooCache();
+    ~ShardedCuckooCache();
+
+    /** Set up the shards to use together at most bytes, and return the number of entries they can hold. */
+    size_t setup_bytes(size_t bytes);
+    void insert(const uint256& entry);
+    /** Look up entry, marking it for removal if found and erase is set (see CuckooCache::cache::contains). */
+    bool contains(const uint256& entry, bool erase) const;
+};
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
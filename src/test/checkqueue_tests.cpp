@@ -230,11 +230,15 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Catches_Failure)
                 vChecks.emplace_back(remaining == 1);
             control.Add(vChecks);
         }
-        bool success = control.Wait();
+        FailingCheck failed(false);
+        bool success = control.Wait(&failed);
         if (i > 0) {
             BOOST_REQUIRE(!success);
+            // The only failing check is handed back
+            BOOST_REQUIRE(failed.fails);
         } else if (i == 0) {
             BOOST_REQUIRE(success);
+            BOOST_REQUIRE(!failed.fails);
         }
     }
     tg.interrupt_all();
@@ -453,6 +453,33 @@ BOOST_AUTO_TEST_CASE(aes_cbc_testvectors) {
     TestAES256CBC("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", \
                   "39F23369A9D9BACFA530E26304231461", true, "f69f2445df4f9b17ad2b417be66c3710", \
                   "b2eb05e2c39be9fcda6c19078c6a9d1b3f461796d6b0d6b2e0c2a72b4d80e644");
+
+    // All four blocks at once (NIST sp800-38a F.2.5)
+    TestAES256CBC("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", \
+                  "000102030405060708090A0B0C0D0E0F", false, \
+                  "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e5130c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710", \
+                  "f58c4c04d6e5f1ba779eabfb5f7bfbd69cfc4e967edb808d679f777bc6702c7d39f23369a9d9bacfa530e26304231461b2eb05e2c39be9fcda6c19078c6a9d1b");
+}
+
+BOOST_AUTO_TEST_CASE(aes_multiple_blocks)
+{
+    // Processing several blocks at once must give the same result as one at a time.
+    std::vector<unsigned char> key = ParseHex("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4");
+    AES256Encrypt enc(key.data());
+    AES256Decrypt dec(key.data());
+    for (size_t blocks = 0; blocks <= 9; ++blocks) {
+        std::vector<unsigned char> in(blocks * AES_BLOCKSIZE);
+        for (auto& c : in) c = InsecureRandBits(8);
+        std::vector<unsigned char> out(in.size()), out_single(in.size());
+        enc.Encrypt(out.data(), in.data(), blocks);
+        for (size_t i = 0; i < blocks; ++i) enc.Encrypt(out_single.data() + i * AES_BLOCKSIZE, in.data() + i * AES_BLOCKSIZE);
+        BOOST_CHECK(out == out_single);
+        std::vector<unsigned char> decrypted(in.size());
+        dec.Decrypt(decrypted.data(), out.data(), blocks);
+        for (size_t i = 0; i < blocks; ++i) dec.Decrypt(out_single.data() + i * AES_BLOCKSIZE, out.data() + i * AES_BLOCKSIZE);
+        BOOST_CHECK(decrypted == in);
+        BOOST_CHECK(out_single == in);
+    }
 }
 
 
@@ -568,6 +595,63 @@ BOOST_AUTO_TEST_CASE(poly1305_testvector)
                  "13000000000000000000000000000000");
 }
 
+BOOST_AUTO_TEST_CASE(chacha20_multiple_blocks)
+{
+    // Long inputs are processed several blocks at a time where possible; they
+    // must give the same output as one block per call, which is never vectorized.
+    std::vector<unsigned char> key = ParseHex("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f");
+    for (uint64_t seek : {uint64_t{0}, uint64_t{0xfffffffa}}) {
+        for (size_t len = 0; len < 20 * 64; len += 61) {
+            std::vector<unsigned char> m(len), expected(len), out(len), keystream(len);
+            for (size_t i = 0; i < len; ++i) m[i] = i * 13;
+
+            ChaCha20 ref(key.data(), key.size());
+            ref.SetIV(0x0706050403020100ULL);
+            ref.Seek(seek);
+            for (size_t pos = 0; pos < len; pos += 64) {
+                ref.Crypt(m.data() + pos, expected.data() + pos, std::min<size_t>(64, len - pos));
+            }
+
+            ChaCha20 ctx(key.data(), key.size());
+            ctx.SetIV(0x0706050403020100ULL);
+            ctx.Seek(seek);
+            ctx.Crypt(m.data(), out.data(), len);
+            BOOST_CHECK(out == expected);
+
+            // In place, and as keystream.
+            ctx.Seek(seek);
+            ctx.Crypt(m.data(), m.data(), len);
+            BOOST_CHECK(m == expected);
+            ctx.Seek(seek);
+            ctx.Keystream(keystream.data(), len);
+            for (size_t i = 0; i < len; ++i) keystream[i] ^= (unsigned char)(i * 13);
+            BOOST_CHECK(keystream == expected);
+
+            // The counter must continue from the same position.
+            unsigned char next[64], next_ref[64];
+            ctx.Keystream(next, 64);
+            ref.Keystream(next_ref, 64);
+            BOOST_CHECK(memcmp(next, next_ref, 64) == 0);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(poly1305_long_inputs)
+{
+    // Authenticate messages of every length up to 1024 bytes, so that all numbers
+    // of whole and partial block groups are covered, then the concatenated tags.
+    std::vector<unsigned char> msg(1024), key(POLY1305_KEYLEN), tags;
+    for (size_t len = 0; len <= msg.size(); ++len) {
+        for (size_t i = 0; i < len; ++i) msg[i] = len + i * 7;
+        for (size_t i = 0; i < key.size(); ++i) key[i] = len * 3 + i;
+        tags.resize(tags.size() + POLY1305_TAGLEN);
+        poly1305_auth(tags.data() + tags.size() - POLY1305_TAGLEN, msg.data(), len, key.data());
+    }
+    std::vector<unsigned char> tag(POLY1305_TAGLEN);
+    poly1305_auth(tag.data(), tags.data(), tags.size(), std::vector<unsigned char>(POLY1305_KEYLEN, 0xff).data());
+    BOOST_CHECK_EQUAL(HexStr(tag), "6c3cda90682887ecb987e9236a0f21d4");
+}
+
 BOOST_AUTO_TEST_CASE(hkdf_hmac_sha256_l32_tests)
 {
     // Use rfc5869 test vectors but truncated to 32 bytes (our implementation only support length 32)
@@ -751,6 +835,27 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(sha256d_multi)
+{
+    for (int i = 0; i <= 40; ++i) {
+        // Messages of all lengths around block boundaries, and some longer ones
+        std::vector<std::vector<unsigned char>> in(i);
+        std::vector<const unsigned char*> inputs;
+        std::vector<size_t> lengths;
+        for (int j = 0; j < i; ++j) {
+            in[j] = g_insecure_rand_ctx.randbytes(j % 4 == 3 ? InsecureRandRange(1000) : InsecureRandRange(130));
+            inputs.push_back(in[j].data());
+            lengths.push_back(in[j].size());
+        }
+        std::vector<unsigned char> out1(32 * i), out2(32 * i);
+        for (int j = 0; j < i; ++j) {
+            CHash256().Write(in[j]).Finalize({out1.data() + 32 * j, 32});
+        }
+        SHA256DMulti(out2.data(), inputs.data(), lengths.data(), i);
+        BOOST_CHECK(out1 == out2);
+    }
+}
+
 static void TestSHA3_256(const std::string& input, const std::string& output)
 {
     const auto in_bytes = ParseHex(input);
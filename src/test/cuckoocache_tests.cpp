@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 #include <boost/test/unit_test.hpp>
 #include <cuckoocache.h>
+#include <atomic>
 #include <deque>
 #include <random.h>
 #include <script/sigcache.h>
@@ -363,4 +364,52 @@ BOOST_AUTO_TEST_CASE(cuckoocache_generations)
     test_cache_generations<CuckooCache::cache<uint256, SignatureCacheHasher>>();
 }
 
+/** ShardedCuckooCache must behave like a single CuckooCache::cache of its total size */
+BOOST_AUTO_TEST_CASE(sharded_cuckoocache_ok)
+{
+    size_t megabytes = 4;
+    for (double load = 0.1; load < 2; load *= 2) {
+        double hits = test_cache<ShardedCuckooCache>(megabytes, load);
+        BOOST_CHECK(normalize_hit_rate(hits, load) > 0.98);
+    }
+    test_cache_erase<ShardedCuckooCache>(megabytes);
+    test_cache_erase_parallel<ShardedCuckooCache>(megabytes);
+    test_cache_generations<ShardedCuckooCache>();
+}
+
+/** ShardedCuckooCache must not need external locks for concurrent inserts and lookups */
+BOOST_AUTO_TEST_CASE(sharded_cuckoocache_concurrent)
+{
+    SeedInsecureRand(SeedRand::ZEROS);
+    ShardedCuckooCache set{};
+    const size_t n_elems = set.setup_bytes(4 << 20);
+    // Keep the load low enough for no entry to be evicted.
+    const size_t n_threads = 4;
+    const size_t n_per_thread = n_elems / 4 / n_threads;
+    std::vector<std::vector<uint256>> hashes(n_threads);
+    for (auto& thread_hashes : hashes) {
+        for (size_t i = 0; i < n_per_thread; ++i) thread_hashes.push_back(InsecureRand256());
+    }
+
+    std::vector<std::thread> threads;
+    std::atomic<size_t> misses{0};
+    for (size_t x = 0; x < n_threads; ++x) {
+        threads.emplace_back([&, x] {
+            for (size_t i = 0; i < n_per_thread; ++i) {
+                set.insert(hashes[x][i]);
+                // Look up entries of other threads, which may or may not have been inserted yet.
+                set.contains(hashes[(x + 1) % n_threads][i], false);
+                if (!set.contains(hashes[x][i], false)) ++misses;
+            }
+        });
+    }
+    for (std::thread& t : threads) t.join();
+
+    BOOST_CHECK_EQUAL(misses.load(), 0U);
+    for (const auto& thread_hashes : hashes) {
+        for (const uint256& h : thread_hashes) misses += !set.contains(h, false);
+    }
+    BOOST_CHECK_EQUAL(misses.load(), 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
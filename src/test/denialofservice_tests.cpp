@@ -6,9 +6,12 @@
 
 #include <arith_uint256.h>
 #include <banman.h>
+#include <blockencodings.h>
 #include <chainparams.h>
+#include <miner.h>
 #include <net.h>
 #include <net_processing.h>
+#include <pow.h>
 #include <pubkey.h>
 #include <script/sign.h>
 #include <script/signingprovider.h>
@@ -65,6 +68,7 @@ static CService ip(uint32_t i)
 static NodeId id = 0;
 
 void UpdateLastBlockAnnounceTime(NodeId node, int64_t time_in_seconds);
+int64_t GetBlockDeliveryTime(NodeId node);
 
 BOOST_FIXTURE_TEST_SUITE(denialofservice_tests, TestingSetup)
 
@@ -219,6 +223,86 @@ BOOST_AUTO_TEST_CASE(stale_tip_peer_management)
     connman->ClearNodes();
 }
 
+BOOST_FIXTURE_TEST_CASE(compact_block_delivery_rate, TestChain100Setup)
+{
+    const CChainParams& chainparams = Params();
+    auto connman = MakeUnique<CConnman>(0x1337, 0x1337);
+    auto peerLogic = std::make_unique<PeerManager>(chainparams, *connman, nullptr, *m_node.scheduler,
+                                                   *m_node.chainman, *m_node.mempool, false);
+
+    CAddress addr(ip(0xa0b0c001), NODE_NONE);
+    CNode dummyNode(id++, ServiceFlags(NODE_NETWORK | NODE_WITNESS), 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", ConnectionType::OUTBOUND_FULL_RELAY);
+    dummyNode.SetCommonVersion(PROTOCOL_VERSION);
+    peerLogic->InitializeNode(&dummyNode);
+    dummyNode.nVersion = PROTOCOL_VERSION;
+    dummyNode.fSuccessfullyConnected = true;
+
+    const int64_t start_time = GetTime();
+    SetMockTime(start_time);
+    std::atomic<bool> interrupt{false};
+    auto process = [&](const std::string& msg_type, CDataStream& stream) {
+        peerLogic->ProcessMessage(dummyNode, msg_type, stream, GetTime<std::chrono::microseconds>(), interrupt);
+    };
+    auto create_block = [&](const std::vector<CMutableTransaction>& txns) {
+        CTxMemPool empty_pool;
+        CBlock block = BlockAssembler(empty_pool, chainparams).CreateNewBlock(CScript() << OP_TRUE)->block;
+        for (const CMutableTransaction& tx : txns) {
+            block.vtx.push_back(MakeTransactionRef(tx));
+        }
+        RegenerateCommitments(block);
+        while (!CheckProofOfWork(block.GetHash(), block.nBits, chainparams.GetConsensus())) ++block.nNonce;
+        return block;
+    };
+
+    CDataStream sendcmpct(SER_NETWORK, PROTOCOL_VERSION);
+    sendcmpct << /* fAnnounceUsingCMPCTBLOCK */ false << /* nCMPCTBLOCKVersion */ uint64_t{2};
+    process(NetMsgType::SENDCMPCT, sendcmpct);
+
+    // A compact block with a transaction we don't know, which has to be requested from the peer
+    CScript p2pk_scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction spend_tx;
+    spend_tx.vin.resize(1);
+    spend_tx.vin[0].prevout = COutPoint(m_coinbase_txns[0]->GetHash(), 0);
+    spend_tx.vout.resize(1);
+    spend_tx.vout[0].nValue = 49 * COIN;
+    spend_tx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(p2pk_scriptPubKey, spend_tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend_tx.vin[0].scriptSig << vchSig;
+    const CBlock block = create_block({spend_tx});
+
+    CDataStream cmpctblock(SER_NETWORK, PROTOCOL_VERSION);
+    cmpctblock << CBlockHeaderAndShortTxIDs(block, /* fUseWTXID */ true);
+    process(NetMsgType::CMPCTBLOCK, cmpctblock);
+    BOOST_CHECK_EQUAL(GetBlockDeliveryTime(dummyNode.GetId()), 0);
+
+    // The peer takes three seconds to send the missing transaction
+    SetMockTime(start_time + 3);
+    BlockTransactions blocktxn;
+    blocktxn.blockhash = block.GetHash();
+    blocktxn.txn = {block.vtx[1]};
+    CDataStream blocktxn_stream(SER_NETWORK, PROTOCOL_VERSION);
+    blocktxn_stream << blocktxn;
+    process(NetMsgType::BLOCKTXN, blocktxn_stream);
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return ::ChainActive().Tip()->GetBlockHash()), block.GetHash());
+    BOOST_CHECK_EQUAL(GetBlockDeliveryTime(dummyNode.GetId()), 3 * 1000000);
+
+    // A compact block that is sent unrequested and reconstructed right away doesn't change the estimate
+    SetMockTime(start_time + 10);
+    const CBlock empty_block = create_block({});
+    CDataStream empty_cmpctblock(SER_NETWORK, PROTOCOL_VERSION);
+    empty_cmpctblock << CBlockHeaderAndShortTxIDs(empty_block, /* fUseWTXID */ true);
+    process(NetMsgType::CMPCTBLOCK, empty_cmpctblock);
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return ::ChainActive().Tip()->GetBlockHash()), empty_block.GetHash());
+    BOOST_CHECK_EQUAL(GetBlockDeliveryTime(dummyNode.GetId()), 3 * 1000000);
+
+    SetMockTime(0);
+    bool dummy;
+    peerLogic->FinalizeNode(dummyNode, dummy);
+}
+
 BOOST_AUTO_TEST_CASE(peer_discouragement)
 {
     const CChainParams& chainparams = Params();
@@ -0,0 +1,117 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <hash.h>
+#include <pubkey.h>
+#include <script/interpreter.h>
+#include <script/script.h>
+#include <script/script_error.h>
+#include <test/fuzz/FuzzedDataProvider.h>
+#include <test/fuzz/fuzz.h>
+#include <test/fuzz/util.h>
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace {
+/**
+ * Signature checker whose result only depends on its arguments, so that the
+ * dedicated code paths and the script interpreter must pass it the same values
+ * to get the same results.
+ */
+class DeterministicSignatureChecker : public BaseSignatureChecker
+{
+public:
+    bool CheckECDSASignature(Span<const unsigned char> sig, Span<const unsigned char> pubkey, const CScript& script_code, SigVersion sigversion) const override
+    {
+        uint256 hash;
+        CHash256().Write(sig).Write(pubkey).Write(script_code).Write({(const unsigned char*)&sigversion, sizeof(sigversion)}).Finalize(hash);
+        return hash.begin()[0] & 1;
+    }
+
+    bool CheckSchnorrSignature(Span<const unsigned char> sig, Span<const unsigned char> pubkey, SigVersion sigversion, const ScriptExecutionData& execdata, ScriptError* serror) const override
+    {
+        assert(execdata.m_annex_init);
+        uint256 hash;
+        CHash256().Write(sig).Write(pubkey).Write({(const unsigned char*)&sigversion, sizeof(sigversion)}).Write({(const unsigned char*)&execdata.m_annex_present, 1}).Finalize(hash);
+        if (hash.begin()[0] & 1) return true;
+        // Fail both with and without setting the error.
+        if (hash.begin()[0] & 2) {
+            if (serror) *serror = SCRIPT_ERR_SCHNORR_SIG;
+        }
+        return false;
+    }
+};
+
+bool IsValidFlagCombination(unsigned flags)
+{
+    if (flags & SCRIPT_VERIFY_CLEANSTACK && ~flags & (SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS)) return false;
+    if (flags & SCRIPT_VERIFY_WITNESS && ~flags & SCRIPT_VERIFY_P2SH) return false;
+    return true;
+}
+} // namespace
+
+void initialize_script_standard_templates()
+{
+    static const ECCVerifyHandle verify_handle;
+}
+
+FUZZ_TARGET_INIT(script_standard_templates, initialize_script_standard_templates)
+{
+    FuzzedDataProvider fuzzed_data_provider(buffer.data(), buffer.size());
+    unsigned int flags = fuzzed_data_provider.ConsumeIntegral<unsigned int>();
+    if (fuzzed_data_provider.ConsumeBool()) flags |= SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS;
+    if (!IsValidFlagCombination(flags)) return;
+
+    // The elements spending the output, of which the second one is the public
+    // key for the templates with a public key hash.
+    std::vector<std::vector<unsigned char>> elements;
+    const size_t num_elements = fuzzed_data_provider.ConsumeIntegralInRange<size_t>(0, 4);
+    for (size_t i = 0; i < num_elements; ++i) {
+        elements.push_back(ConsumeRandomLengthByteVector(fuzzed_data_provider, 600));
+    }
+    std::vector<unsigned char> pubkey_hash;
+    if (elements.size() >= 2 && fuzzed_data_provider.ConsumeBool()) {
+        pubkey_hash = ToByteVector(Hash160(elements[1]));
+    } else {
+        pubkey_hash = ConsumeFixedLengthByteVector(fuzzed_data_provider, 20);
+    }
+
+    CScript script_sig;
+    CScriptWitness witness;
+    CScript script_pubkey;
+    switch (fuzzed_data_provider.ConsumeIntegralInRange<int>(0, 3)) {
+    case 0:
+        script_pubkey << OP_DUP << OP_HASH160 << pubkey_hash << OP_EQUALVERIFY << OP_CHECKSIG;
+        if (fuzzed_data_provider.ConsumeBool()) {
+            for (const auto& element : elements) script_sig << element;
+        } else {
+            script_sig = ConsumeScript(fuzzed_data_provider);
+        }
+        if (fuzzed_data_provider.ConsumeBool()) witness.stack = elements;
+        break;
+    case 1:
+        script_pubkey << OP_0 << pubkey_hash;
+        witness.stack = elements;
+        break;
+    case 2:
+        script_pubkey << OP_1 << ConsumeFixedLengthByteVector(fuzzed_data_provider, WITNESS_V1_TAPROOT_SIZE);
+        witness.stack = elements;
+        break;
+    case 3:
+        script_pubkey = ConsumeScript(fuzzed_data_provider);
+        witness.stack = elements;
+        break;
+    }
+    if (fuzzed_data_provider.ConsumeBool()) script_sig = ConsumeScript(fuzzed_data_provider);
+
+    const DeterministicSignatureChecker checker;
+    ScriptError serror;
+    const bool ret = VerifyScript(script_sig, script_pubkey, &witness, flags, checker, &serror);
+    ScriptError serror_generic;
+    const bool ret_generic = VerifyScriptGeneric(script_sig, script_pubkey, &witness, flags, checker, &serror_generic);
+    assert(ret == ret_generic);
+    assert(serror == serror_generic);
+}
@@ -4,6 +4,7 @@
 
 #include <policy/policy.h>
 #include <txmempool.h>
+#include <util/rbf.h>
 #include <util/system.h>
 #include <util/time.h>
 
@@ -108,6 +109,246 @@ BOOST_AUTO_TEST_CASE(MempoolRemoveTest)
     BOOST_CHECK_EQUAL(testPool.size(), 0U);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolRelayOrderKeyTest)
+{
+    TestMemPoolEntryHelper entry;
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+
+    // A parent with three children of different fees, and an unrelated transaction
+    CMutableTransaction tx_parent;
+    tx_parent.vin.resize(1);
+    tx_parent.vin[0].scriptSig = CScript() << OP_11;
+    tx_parent.vout.resize(3);
+    for (int i = 0; i < 3; i++) {
+        tx_parent.vout[i].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx_parent.vout[i].nValue = 33000LL;
+    }
+    pool.addUnchecked(entry.Fee(1000LL).FromTx(tx_parent));
+    std::vector<uint256> hashes{tx_parent.GetHash()};
+    for (int i = 0; i < 3; i++) {
+        CMutableTransaction tx_child;
+        tx_child.vin.resize(1);
+        tx_child.vin[0].scriptSig = CScript() << OP_11;
+        tx_child.vin[0].prevout = COutPoint(tx_parent.GetHash(), i);
+        tx_child.vout.resize(1);
+        tx_child.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx_child.vout[0].nValue = 11000LL;
+        pool.addUnchecked(entry.Fee(i * 2000LL).FromTx(tx_child));
+        hashes.push_back(tx_child.GetHash());
+    }
+    CMutableTransaction tx_other;
+    tx_other.vin.resize(1);
+    tx_other.vin[0].scriptSig = CScript() << OP_12;
+    tx_other.vout.resize(1);
+    tx_other.vout[0].scriptPubKey = CScript() << OP_12 << OP_EQUAL;
+    tx_other.vout[0].nValue = 10000LL;
+    pool.addUnchecked(entry.Fee(2000LL).FromTx(tx_other));
+    hashes.push_back(tx_other.GetHash());
+
+    BOOST_CHECK(!pool.GetRelayOrderKey(uint256::ONE));
+    for (const uint256& a : hashes) {
+        const auto key_a = pool.GetRelayOrderKey(a);
+        BOOST_REQUIRE(key_a);
+        BOOST_CHECK(key_a->m_txid == a);
+        // These transactions have no witness, so their wtxid is their txid
+        BOOST_CHECK(pool.GetRelayOrderKey(a, /* wtxid */ true));
+        for (const uint256& b : hashes) {
+            const auto key_b = pool.GetRelayOrderKey(b);
+            BOOST_REQUIRE(key_b);
+            BOOST_CHECK_EQUAL(*key_a < *key_b, pool.CompareDepthAndScore(a, b));
+        }
+    }
+
+    // The batched lookup returns the same keys, and the epoch they are valid for
+    uint64_t epoch;
+    const auto keys = pool.GetRelayOrderKeys({hashes[1], uint256::ONE}, epoch);
+    BOOST_REQUIRE_EQUAL(keys.size(), 2U);
+    BOOST_REQUIRE(keys[0]);
+    BOOST_CHECK_EQUAL(keys[0]->m_count_with_ancestors, 2U);
+    BOOST_CHECK(!keys[1]);
+    BOOST_CHECK_EQUAL(epoch, pool.GetRelayOrderEpoch());
+
+    // Removing a transaction with its descendants leaves the other keys alone
+    pool.removeRecursive(CTransaction(tx_other), REMOVAL_REASON_DUMMY);
+    BOOST_CHECK_EQUAL(pool.GetRelayOrderEpoch(), epoch);
+
+    // Mining the parent takes an ancestor from each child
+    pool.removeForBlock({MakeTransactionRef(tx_parent)}, 1);
+    BOOST_CHECK(pool.GetRelayOrderEpoch() != epoch);
+    const auto key_child = pool.GetRelayOrderKey(hashes[1]);
+    BOOST_REQUIRE(key_child);
+    BOOST_CHECK_EQUAL(key_child->m_count_with_ancestors, 1U);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolClusterLinearizationTest)
+{
+    TestMemPoolEntryHelper entry;
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+
+    // A low fee parent with three children (one of them paying no fee), a
+    // grandchild of the highest paying child, and an unrelated transaction
+    CMutableTransaction tx_parent;
+    tx_parent.vin.resize(1);
+    tx_parent.vin[0].scriptSig = CScript() << OP_11;
+    tx_parent.vout.resize(3);
+    for (int i = 0; i < 3; i++) {
+        tx_parent.vout[i].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx_parent.vout[i].nValue = 33000LL;
+    }
+    pool.addUnchecked(entry.Fee(1000LL).FromTx(tx_parent));
+    std::vector<CMutableTransaction> children;
+    for (int i = 0; i < 3; i++) {
+        CMutableTransaction tx_child;
+        tx_child.vin.resize(1);
+        tx_child.vin[0].scriptSig = CScript() << OP_11;
+        tx_child.vin[0].prevout = COutPoint(tx_parent.GetHash(), i);
+        tx_child.vout.resize(1);
+        tx_child.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx_child.vout[0].nValue = 11000LL;
+        pool.addUnchecked(entry.Fee(i * 20000LL).FromTx(tx_child));
+        children.push_back(tx_child);
+    }
+    CMutableTransaction tx_grandchild;
+    tx_grandchild.vin.resize(1);
+    tx_grandchild.vin[0].scriptSig = CScript() << OP_11;
+    tx_grandchild.vin[0].prevout = COutPoint(children[2].GetHash(), 0);
+    tx_grandchild.vout.resize(1);
+    tx_grandchild.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx_grandchild.vout[0].nValue = 10000LL;
+    pool.addUnchecked(entry.Fee(100LL).FromTx(tx_grandchild));
+    CMutableTransaction tx_other;
+    tx_other.vin.resize(1);
+    tx_other.vin[0].scriptSig = CScript() << OP_12;
+    tx_other.vout.resize(1);
+    tx_other.vout[0].scriptPubKey = CScript() << OP_12 << OP_EQUAL;
+    tx_other.vout[0].nValue = 10000LL;
+    pool.addUnchecked(entry.Fee(2000LL).FromTx(tx_other));
+
+    // Unrelated transaction is a cluster of its own
+    const auto other_cluster = pool.GatherCluster(*pool.GetIter(tx_other.GetHash()));
+    BOOST_REQUIRE(other_cluster);
+    BOOST_CHECK_EQUAL(other_cluster->size(), 1U);
+    const auto other_chunks = pool.LinearizeCluster(*other_cluster);
+    BOOST_REQUIRE_EQUAL(other_chunks.size(), 1U);
+    BOOST_CHECK_EQUAL(other_chunks[0].fee, 2000LL);
+
+    // Cluster is the same no matter which member it is gathered from
+    const auto cluster = pool.GatherCluster(*pool.GetIter(tx_grandchild.GetHash()));
+    BOOST_REQUIRE(cluster);
+    BOOST_CHECK_EQUAL(cluster->size(), 5U);
+    BOOST_CHECK_EQUAL(pool.GatherCluster(*pool.GetIter(children[0].GetHash()))->size(), 5U);
+
+    const auto chunks = pool.LinearizeCluster(*cluster);
+    BOOST_REQUIRE(chunks.size() >= 2);
+    std::vector<uint256> order;
+    CAmount total_fee{0};
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        // Chunk feerates never increase
+        if (i > 0) BOOST_CHECK(double(chunks[i].fee) * chunks[i - 1].size <= double(chunks[i - 1].fee) * chunks[i].size);
+        total_fee += chunks[i].fee;
+        for (const auto& it : chunks[i].txs) order.push_back(it->GetTx().GetHash());
+    }
+    BOOST_CHECK_EQUAL(total_fee, 1000LL + 0LL + 20000LL + 40000LL + 100LL);
+    BOOST_REQUIRE_EQUAL(order.size(), 5U);
+    // Topologically valid, with the parent of the best paying child first
+    BOOST_CHECK(order[0] == tx_parent.GetHash());
+    const auto position = [&](const uint256& hash) { return std::find(order.begin(), order.end(), hash) - order.begin(); };
+    BOOST_CHECK(position(children[2].GetHash()) < position(tx_grandchild.GetHash()));
+    BOOST_CHECK(position(children[2].GetHash()) < position(children[1].GetHash()));
+    // The child paying no fee is what should be evicted first
+    BOOST_CHECK(order.back() == children[0].GetHash());
+    BOOST_CHECK_EQUAL(chunks.back().txs.size(), 1U);
+
+    // Clusters larger than MAX_LINEARIZED_CLUSTER_SIZE are not gathered
+    CMutableTransaction tx_fanout;
+    tx_fanout.vin.resize(1);
+    tx_fanout.vin[0].scriptSig = CScript() << OP_13;
+    tx_fanout.vout.resize(MAX_LINEARIZED_CLUSTER_SIZE);
+    for (auto& out : tx_fanout.vout) {
+        out.scriptPubKey = CScript() << OP_13 << OP_EQUAL;
+        out.nValue = 1000LL;
+    }
+    pool.addUnchecked(entry.Fee(1000LL).FromTx(tx_fanout));
+    for (size_t i = 0; i < MAX_LINEARIZED_CLUSTER_SIZE; i++) {
+        CMutableTransaction tx_spend;
+        tx_spend.vin.resize(1);
+        tx_spend.vin[0].scriptSig = CScript() << OP_13;
+        tx_spend.vin[0].prevout = COutPoint(tx_fanout.GetHash(), i);
+        tx_spend.vout.resize(1);
+        tx_spend.vout[0].scriptPubKey = CScript() << OP_13 << OP_EQUAL;
+        tx_spend.vout[0].nValue = 900LL;
+        pool.addUnchecked(entry.Fee(100LL).FromTx(tx_spend));
+        BOOST_CHECK_EQUAL(bool(pool.GatherCluster(*pool.GetIter(tx_fanout.GetHash()))), i + 2 <= MAX_LINEARIZED_CLUSTER_SIZE);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MempoolEntrySnapshotTest)
+{
+    TestMemPoolEntryHelper entry;
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+
+    // A chain of three transactions where only the first one signals BIP125,
+    // and an unrelated transaction that does not signal
+    std::vector<CMutableTransaction> chain;
+    for (int i = 0; i < 3; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].scriptSig = CScript() << OP_11;
+        if (i == 0) {
+            tx.vin[0].nSequence = MAX_BIP125_RBF_SEQUENCE;
+        } else {
+            tx.vin[0].prevout = COutPoint(chain.back().GetHash(), 0);
+        }
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx.vout[0].nValue = 10000LL;
+        pool.addUnchecked(entry.Fee(1000LL).FromTx(tx));
+        chain.push_back(tx);
+    }
+    CMutableTransaction tx_other;
+    tx_other.vin.resize(1);
+    tx_other.vin[0].scriptSig = CScript() << OP_12;
+    tx_other.vout.resize(1);
+    tx_other.vout[0].scriptPubKey = CScript() << OP_12 << OP_EQUAL;
+    tx_other.vout[0].nValue = 10000LL;
+    pool.addUnchecked(entry.Fee(2000LL).FromTx(tx_other));
+    pool.AddUnbroadcastTx(tx_other.GetHash());
+
+    const std::vector<TxMempoolEntrySnapshot> snapshots{pool.GetEntrySnapshots()};
+    BOOST_REQUIRE_EQUAL(snapshots.size(), 4U);
+    for (const TxMempoolEntrySnapshot& snapshot : snapshots) {
+        const uint256& txid = snapshot.tx->GetHash();
+        // Taking all snapshots at once agrees with taking them one by one
+        const TxMempoolEntrySnapshot single{pool.GetEntrySnapshot(pool.mapTx.find(txid))};
+        BOOST_CHECK_EQUAL(snapshot.bip125_replaceable, single.bip125_replaceable);
+        BOOST_CHECK_EQUAL(snapshot.count_with_ancestors, single.count_with_ancestors);
+        BOOST_CHECK(snapshot.parents == single.parents);
+        BOOST_CHECK(snapshot.children == single.children);
+        BOOST_CHECK(snapshot.wtxid == snapshot.tx->GetWitnessHash());
+
+        if (txid == tx_other.GetHash()) {
+            BOOST_CHECK(!snapshot.bip125_replaceable);
+            BOOST_CHECK(snapshot.unbroadcast);
+            BOOST_CHECK_EQUAL(snapshot.fee, 2000LL);
+            continue;
+        }
+        // Descendants of a signaling transaction are replaceable as well
+        BOOST_CHECK(snapshot.bip125_replaceable);
+        BOOST_CHECK(!snapshot.unbroadcast);
+        if (txid == chain[1].GetHash()) {
+            BOOST_CHECK_EQUAL(snapshot.count_with_ancestors, 2U);
+            BOOST_CHECK_EQUAL(snapshot.count_with_descendants, 2U);
+            BOOST_REQUIRE_EQUAL(snapshot.parents.size(), 1U);
+            BOOST_CHECK(snapshot.parents[0] == chain[0].GetHash());
+            BOOST_REQUIRE_EQUAL(snapshot.children.size(), 1U);
+            BOOST_CHECK(snapshot.children[0] == chain[2].GetHash());
+        }
+    }
+}
+
 template<typename name>
 static void CheckSort(CTxMemPool &pool, std::vector<std::string> &sortedOrder) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
 {
@@ -348,4 +348,36 @@ BOOST_AUTO_TEST_CASE(merkle_test_BlockWitness)
 
     BOOST_CHECK_EQUAL(merkleRootofHashes, blockWitness);
 }
+
+BOOST_AUTO_TEST_CASE(merkle_test_incremental)
+{
+    IncrementalMerkleTree tree;
+    BOOST_CHECK_EQUAL(tree.Root(), ComputeMerkleRoot({}));
+
+    std::vector<uint256> leaves;
+    for (int i = 0; i < 70; ++i) {
+        leaves.push_back(InsecureRand256());
+        tree.Append(leaves.back());
+        BOOST_CHECK_EQUAL(tree.Size(), leaves.size());
+        BOOST_CHECK_EQUAL(tree.Root(), ComputeMerkleRoot(leaves));
+
+        // Replace the first leaf (e.g. the coinbase) and a random one
+        for (const size_t pos : {size_t{0}, size_t(InsecureRandRange(leaves.size()))}) {
+            leaves[pos] = InsecureRand256();
+            tree.Update(pos, leaves[pos]);
+            BOOST_CHECK_EQUAL(tree.Root(), ComputeMerkleRoot(leaves));
+        }
+
+        // A tree built at once matches, and can be updated in the same way
+        IncrementalMerkleTree built(leaves);
+        BOOST_CHECK_EQUAL(built.Size(), leaves.size());
+        BOOST_CHECK_EQUAL(built.Root(), tree.Root());
+        const size_t pos = InsecureRandRange(leaves.size());
+        leaves[pos] = InsecureRand256();
+        built.Update(pos, leaves[pos]);
+        tree.Update(pos, leaves[pos]);
+        BOOST_CHECK_EQUAL(built.Root(), ComputeMerkleRoot(leaves));
+        BOOST_CHECK_EQUAL(tree.Root(), built.Root());
+    }
+}
 BOOST_AUTO_TEST_SUITE_END()
@@ -506,6 +506,15 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     BOOST_CHECK(pblocktemplate = AssemblerForTest(chainparams).CreateNewBlock(scriptPubKey));
     BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 5U);
 
+    // Rolling the extranonce with a merkle tree yields the same root as recomputing it
+    IncrementalMerkleTree merkle_tree;
+    unsigned int extra_nonce = 0;
+    for (int i = 0; i < 3; i++) {
+        IncrementExtraNonce(&pblocktemplate->block, ::ChainActive().Tip(), extra_nonce, &merkle_tree);
+        BOOST_CHECK_EQUAL(merkle_tree.Size(), 5U);
+        BOOST_CHECK_EQUAL(pblocktemplate->block.hashMerkleRoot, BlockMerkleRoot(pblocktemplate->block));
+    }
+
     ::ChainActive().Tip()->nHeight--;
     SetMockTime(0);
     m_node.mempool->clear();
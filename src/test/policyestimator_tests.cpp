@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <policy/fees.h>
+#include <policy/mempool_fees.h>
 #include <policy/policy.h>
 #include <txmempool.h>
 #include <uint256.h>
@@ -180,4 +181,101 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
     }
 }
 
+BOOST_AUTO_TEST_CASE(MempoolPolicyEstimates)
+{
+    CTxMemPool mpool;
+    TestMemPoolEntryHelper entry;
+    SetMockTime(1000);
+
+    const auto add_tx = [&](CAmount fee, uint32_t locktime) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].scriptSig = CScript() << OP_1;
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+        tx.vout[0].nValue = 1 * COIN;
+        tx.nLockTime = locktime;
+        LOCK2(cs_main, mpool.cs);
+        mpool.addUnchecked(entry.Fee(fee).FromTx(tx));
+        return mpool.GetIter(tx.GetHash()).value();
+    };
+
+    // 35 transactions of the same size with increasing fees, 10 of which fit in a block
+    CTxMemPool::txiter it;
+    for (int i = 0; i < 35; ++i) {
+        it = add_tx(1000 * (i + 1), i);
+    }
+    const int32_t size = it->GetTxSize();
+    MempoolFeeEstimator estimator(mpool, 10 * it->GetTxWeight());
+
+    BOOST_CHECK(estimator.EstimateFee(0) == CFeeRate(0));
+    BOOST_CHECK(estimator.EstimateFee(1) == CFeeRate(26000, size));
+    BOOST_CHECK(estimator.EstimateFee(2) == CFeeRate(16000, size));
+    BOOST_CHECK(estimator.EstimateFee(3) == CFeeRate(6000, size));
+    // The remaining 5 transactions only partially fill a fourth block
+    BOOST_CHECK(estimator.EstimateFee(4) == CFeeRate(0));
+    BOOST_CHECK(estimator.EstimateFee(MEMPOOL_FEE_ESTIMATE_MAX_TARGET + 1) == CFeeRate(0));
+
+    // Estimates are cached until they are old enough
+    for (int i = 0; i < 10; ++i) {
+        add_tx(100000 + i, 100 + i);
+    }
+    BOOST_CHECK(estimator.EstimateFee(1) == CFeeRate(26000, size));
+    SetMockTime(1000 + count_seconds(MEMPOOL_FEE_ESTIMATE_INTERVAL));
+    BOOST_CHECK(estimator.EstimateFee(1) == CFeeRate(100000, size));
+    BOOST_CHECK(estimator.EstimateFee(2) == CFeeRate(26000, size));
+    BOOST_CHECK(estimator.EstimateFee(4) == CFeeRate(6000, size));
+    unsigned int returned_target;
+    BOOST_CHECK(estimator.EstimateFee(2, &returned_target) == CFeeRate(26000, size));
+    BOOST_CHECK_EQUAL(returned_target, 2U);
+
+    // A target whose feerate is already reached at a lower one returns the lower target
+    for (int i = 0; i < 10; ++i) {
+        add_tx(100000, 200 + i);
+    }
+    SetMockTime(1000 + 2 * count_seconds(MEMPOOL_FEE_ESTIMATE_INTERVAL));
+    BOOST_CHECK(estimator.EstimateFee(2, &returned_target) == CFeeRate(100000, size));
+    BOOST_CHECK_EQUAL(returned_target, 1U);
+    BOOST_CHECK(estimator.EstimateFee(3, &returned_target) == CFeeRate(26000, size));
+    BOOST_CHECK_EQUAL(returned_target, 3U);
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolPolicyEstimatesCPFP)
+{
+    CTxMemPool mpool;
+    TestMemPoolEntryHelper entry;
+
+    const auto add_tx = [&](CAmount fee, uint32_t locktime, const COutPoint& prevout) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = prevout;
+        tx.vin[0].scriptSig = CScript() << OP_1;
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+        tx.vout[0].nValue = 1 * COIN;
+        tx.nLockTime = locktime;
+        LOCK2(cs_main, mpool.cs);
+        mpool.addUnchecked(entry.Fee(fee).FromTx(tx));
+        return mpool.GetIter(tx.GetHash()).value();
+    };
+
+    // A high fee parent with a low fee child, and 20 transactions of the same
+    // size with increasing fees, 10 of which fit in a block
+    const CTxMemPool::txiter parent = add_tx(100000, 0, COutPoint());
+    add_tx(1000, 0, COutPoint(parent->GetTx().GetHash(), 0));
+    for (int i = 1; i <= 20; ++i) {
+        add_tx(1000 * (i + 1), i, COutPoint());
+    }
+    const int32_t size = parent->GetTxSize();
+    MempoolFeeEstimator estimator(mpool, 10 * parent->GetTxWeight());
+
+    // Once the parent is selected, the child only pays for itself, so it goes
+    // last instead of lowering the feerate of the first block.
+    BOOST_CHECK(estimator.EstimateFee(1) == CFeeRate(13000, size));
+    BOOST_CHECK(estimator.EstimateFee(2) == CFeeRate(3000, size));
+    BOOST_CHECK(estimator.EstimateFee(3) == CFeeRate(0));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
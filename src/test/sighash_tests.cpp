@@ -205,4 +205,65 @@ BOOST_AUTO_TEST_CASE(sighash_from_data)
         BOOST_CHECK_MESSAGE(sh.GetHex() == sigHashHex, strTest);
     }
 }
+
+BOOST_AUTO_TEST_CASE(sighash_precomputed_preambles)
+{
+    for (int i = 0; i < 1000; i++) {
+        CMutableTransaction tx;
+        RandomTransaction(tx, false);
+        std::vector<CTxOut> spent_outputs(tx.vin.size());
+        for (auto& txout : spent_outputs) {
+            txout.nValue = InsecureRandRange(100000000);
+            RandomScript(txout.scriptPubKey);
+        }
+        PrecomputedTransactionData txdata;
+        txdata.Init(tx, std::vector<CTxOut>(spent_outputs), /* force */ true);
+        // Preambles are computed for all hash types if multiple inputs could use them.
+        const bool multiple_inputs = tx.vin.size() >= 2;
+        BOOST_CHECK_EQUAL(txdata.m_bip143_preamble.has_value(), multiple_inputs);
+        BOOST_CHECK_EQUAL(txdata.m_bip341_preambles[SIGHASH_DEFAULT].has_value(), multiple_inputs);
+        BOOST_CHECK_EQUAL(txdata.m_bip341_preambles[SIGHASH_ALL].has_value(), multiple_inputs);
+        // The same data without the preambles.
+        PrecomputedTransactionData txdata_plain = txdata;
+        txdata_plain.m_bip143_preamble.reset();
+        for (auto& preamble : txdata_plain.m_bip341_preambles) preamble.reset();
+
+        const unsigned int in_pos = InsecureRandRange(tx.vin.size());
+        const int hash_type = InsecureRandBool() ? InsecureRand32() : InsecureRandRange(4);
+        CScript script_code;
+        RandomScript(script_code);
+        const uint256 sighash = SignatureHash(script_code, tx, in_pos, hash_type, 0, SigVersion::WITNESS_V0, &txdata);
+        BOOST_CHECK(sighash == SignatureHash(script_code, tx, in_pos, hash_type, 0, SigVersion::WITNESS_V0, &txdata_plain));
+        BOOST_CHECK(sighash == SignatureHash(script_code, tx, in_pos, hash_type, 0, SigVersion::WITNESS_V0));
+
+        ScriptExecutionData execdata;
+        execdata.m_annex_init = true;
+        execdata.m_annex_present = InsecureRandBool();
+        execdata.m_annex_hash = InsecureRand256();
+        execdata.m_tapleaf_hash_init = true;
+        execdata.m_tapleaf_hash = InsecureRand256();
+        execdata.m_codeseparator_pos_init = true;
+        execdata.m_codeseparator_pos = InsecureRand32();
+        const SigVersion sigversion = InsecureRandBool() ? SigVersion::TAPROOT : SigVersion::TAPSCRIPT;
+        const uint8_t schnorr_hash_type = InsecureRandBool() ? InsecureRandBits(8) : InsecureRandRange(4);
+        uint256 schnorr_sighash, schnorr_sighash_plain;
+        const bool ret = SignatureHashSchnorr(schnorr_sighash, execdata, tx, in_pos, schnorr_hash_type, sigversion, txdata);
+        BOOST_CHECK_EQUAL(ret, SignatureHashSchnorr(schnorr_sighash_plain, execdata, tx, in_pos, schnorr_hash_type, sigversion, txdata_plain));
+        if (ret) BOOST_CHECK(schnorr_sighash == schnorr_sighash_plain);
+    }
+
+    // Without force, preambles are computed for the hash types used by multiple inputs.
+    CMutableTransaction tx;
+    tx.vin.resize(3);
+    tx.vout.resize(1);
+    const CScript taproot_script = CScript() << OP_1 << std::vector<unsigned char>(WITNESS_V1_TAPROOT_SIZE, 1);
+    std::vector<CTxOut> spent_outputs(3, CTxOut(1000, taproot_script));
+    tx.vin[0].scriptWitness.stack = {std::vector<unsigned char>(64)};
+    tx.vin[1].scriptWitness.stack = {std::vector<unsigned char>(64), std::vector<unsigned char>(1, ANNEX_TAG)};
+    tx.vin[2].scriptWitness.stack = {std::vector<unsigned char>(65, SIGHASH_ALL)};
+    PrecomputedTransactionData txdata;
+    txdata.Init(tx, std::move(spent_outputs));
+    BOOST_CHECK(txdata.m_bip341_taproot_ready && !txdata.m_bip143_segwit_ready);
+    BOOST_CHECK(txdata.m_bip341_preambles[SIGHASH_DEFAULT] && !txdata.m_bip341_preambles[SIGHASH_ALL]);
+}
 BOOST_AUTO_TEST_SUITE_END()
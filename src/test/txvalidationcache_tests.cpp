@@ -371,4 +371,61 @@ BOOST_FIXTURE_TEST_CASE(checkinputs_test, TestChain100Setup)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(checkinputs_many_inputs_test, TestChain100Setup)
+{
+    // Transactions with at least MIN_PARALLEL_TX_SCRIPT_CHECK_INPUTS inputs have
+    // their scripts checked on the script-checking threads; results must match
+    // the serial checks, including the reported failure.
+    CScript p2pk_scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    CMutableTransaction spend_tx;
+    spend_tx.nVersion = 1;
+    spend_tx.vin.resize(MIN_PARALLEL_TX_SCRIPT_CHECK_INPUTS);
+    for (unsigned int i = 0; i < spend_tx.vin.size(); i++) {
+        spend_tx.vin[i].prevout = COutPoint(m_coinbase_txns[i + 1]->GetHash(), 0);
+    }
+    spend_tx.vout.resize(1);
+    spend_tx.vout[0].nValue = 11*CENT;
+    spend_tx.vout[0].scriptPubKey = p2pk_scriptPubKey;
+    for (unsigned int i = 0; i < spend_tx.vin.size(); i++) {
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(p2pk_scriptPubKey, spend_tx, i, SIGHASH_ALL, 0, SigVersion::BASE);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        spend_tx.vin[i].scriptSig << vchSig;
+    }
+
+    // Swap two signatures, so that both become invalid.
+    CMutableTransaction invalid_tx = spend_tx;
+    std::swap(invalid_tx.vin[0].scriptSig, invalid_tx.vin[MIN_PARALLEL_TX_SCRIPT_CHECK_INPUTS - 1].scriptSig);
+
+    LOCK(cs_main);
+    const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG;
+    {
+        TxValidationState state;
+        PrecomputedTransactionData txdata;
+        BOOST_CHECK(CheckInputScripts(CTransaction(spend_tx), state, &::ChainstateActive().CoinsTip(), flags, true, false, txdata, nullptr));
+        BOOST_CHECK(state.IsValid());
+    }
+    {
+        TxValidationState state;
+        PrecomputedTransactionData txdata;
+        BOOST_CHECK(!CheckInputScripts(CTransaction(invalid_tx), state, &::ChainstateActive().CoinsTip(), flags, true, false, txdata, nullptr));
+        BOOST_CHECK(state.GetResult() == TxValidationResult::TX_CONSENSUS);
+        BOOST_CHECK_EQUAL(state.GetRejectReason(), "mandatory-script-verify-flag-failed (Script evaluated without error but finished with a false/empty top stack element)");
+    }
+
+    // An extra stack element only fails the non-mandatory CLEANSTACK rule.
+    CMutableTransaction nonstandard_tx = spend_tx;
+    CScript& script_sig = nonstandard_tx.vin[MIN_PARALLEL_TX_SCRIPT_CHECK_INPUTS / 2].scriptSig;
+    script_sig.insert(script_sig.begin(), OP_1);
+    {
+        TxValidationState state;
+        PrecomputedTransactionData txdata;
+        BOOST_CHECK(!CheckInputScripts(CTransaction(nonstandard_tx), state, &::ChainstateActive().CoinsTip(), flags | SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_CLEANSTACK, true, false, txdata, nullptr));
+        BOOST_CHECK(state.GetResult() == TxValidationResult::TX_NOT_STANDARD);
+        BOOST_CHECK_EQUAL(state.GetRejectReason(), "non-mandatory-script-verify-flag (Stack size must be exactly one after execution)");
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
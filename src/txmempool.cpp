@@ -16,14 +16,15 @@
 #include <reverse_iterator.h>
 #include <util/system.h>
 #include <util/moneystr.h>
+#include <util/rbf.h>
 #include <util/time.h>
 #include <validationinterface.h>
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                                  int64_t _nTime, unsigned int _entryHeight,
                                  bool _spendsCoinbase, int64_t _sigOpsCost, LockPoints lp)
-    : tx(_tx), nFee(_nFee), nTxWeight(GetTransactionWeight(*tx)), nUsageSize(RecursiveDynamicUsage(tx)), nTime(_nTime), entryHeight(_entryHeight),
-    spendsCoinbase(_spendsCoinbase), sigOpCost(_sigOpsCost), lockPoints(lp), m_epoch(0)
+    : tx(_tx), nFee(_nFee), nUsageSize(RecursiveDynamicUsage(tx)), nTime(_nTime), sigOpCost(_sigOpsCost), lockPoints(lp),
+    nTxWeight(GetTransactionWeight(*tx)), entryHeight(_entryHeight), spendsCoinbase(_spendsCoinbase), m_epoch(0)
 {
     nCountWithDescendants = 1;
     nSizeWithDescendants = GetTxSize();
@@ -107,6 +108,8 @@ void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendan
 void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashesToUpdate)
 {
     AssertLockHeld(cs);
+    // Transactions that were in the mempool already may get new ancestors.
+    ++m_relay_order_epoch;
     // For each entry in vHashesToUpdate, store the set of in-mempool, but not
     // in-vHashesToUpdate transactions, so that we don't have to recalculate
     // descendants when we come across a previously seen entry.
@@ -178,7 +181,7 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
     size_t totalSizeWithAncestors = entry.GetTxSize();
 
     while (!staged_ancestors.empty()) {
-        const CTxMemPoolEntry& stage = staged_ancestors.begin()->get();
+        const CTxMemPoolEntry& stage = *staged_ancestors.begin();
         txiter stageit = mapTx.iterator_to(stage);
 
         setAncestors.insert(stageit);
@@ -433,7 +436,7 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 
     totalTxSize -= it->GetTxSize();
     cachedInnerUsage -= it->DynamicMemoryUsage();
-    cachedInnerUsage -= memusage::DynamicUsage(it->GetMemPoolParentsConst()) + memusage::DynamicUsage(it->GetMemPoolChildrenConst());
+    cachedInnerUsage -= it->GetMemPoolParentsConst().DynamicMemoryUsage() + it->GetMemPoolChildrenConst().DynamicMemoryUsage();
     mapTx.erase(it);
     nTransactionsUpdated++;
     if (minerPolicyEstimator) {minerPolicyEstimator->removeTx(hash, false);}
@@ -469,6 +472,119 @@ void CTxMemPool::CalculateDescendants(txiter entryit, setEntries& setDescendants
     }
 }
 
+Optional<std::vector<CTxMemPool::txiter>> CTxMemPool::GatherCluster(txiter it) const
+{
+    AssertLockHeld(cs);
+    std::vector<txiter> cluster{it};
+    setEntries visited{it};
+    // Breadth-first walk over both parent and child links.
+    for (size_t i = 0; i < cluster.size(); ++i) {
+        if (cluster.size() > MAX_LINEARIZED_CLUSTER_SIZE) return nullopt;
+        const CTxMemPoolEntry& entry = *cluster[i];
+        for (const CTxMemPoolEntry& parent : entry.GetMemPoolParentsConst()) {
+            txiter parentiter = mapTx.iterator_to(parent);
+            if (visited.insert(parentiter).second) cluster.push_back(parentiter);
+        }
+        for (const CTxMemPoolEntry& child : entry.GetMemPoolChildrenConst()) {
+            txiter childiter = mapTx.iterator_to(child);
+            if (visited.insert(childiter).second) cluster.push_back(childiter);
+        }
+    }
+    if (cluster.size() > MAX_LINEARIZED_CLUSTER_SIZE) return nullopt;
+    return cluster;
+}
+
+std::vector<CTxMemPool::ClusterChunk> CTxMemPool::LinearizeCluster(const std::vector<txiter>& cluster) const
+{
+    AssertLockHeld(cs);
+    static_assert(MAX_LINEARIZED_CLUSTER_SIZE <= 64, "ancestor sets are 64-bit masks");
+    assert(cluster.size() <= MAX_LINEARIZED_CLUSTER_SIZE);
+    // Sort by in-mempool ancestor count; a parent always has fewer ancestors
+    // than its children, so this is a topological order.
+    std::vector<txiter> topo(cluster);
+    std::sort(topo.begin(), topo.end(), [](txiter a, txiter b) {
+        if (a->GetCountWithAncestors() != b->GetCountWithAncestors()) {
+            return a->GetCountWithAncestors() < b->GetCountWithAncestors();
+        }
+        return a->GetTx().GetHash() < b->GetTx().GetHash();
+    });
+    const size_t n = topo.size();
+    std::map<txiter, size_t, CompareIteratorByHash> pos;
+    for (size_t i = 0; i < n; ++i) pos.emplace(topo[i], i);
+
+    // Ancestor sets restricted to the cluster, as bitmasks of positions (including self).
+    std::vector<uint64_t> ancestors(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+        ancestors[i] = uint64_t{1} << i;
+        for (const CTxMemPoolEntry& parent : topo[i]->GetMemPoolParentsConst()) {
+            ancestors[i] |= ancestors[pos.at(mapTx.iterator_to(parent))];
+        }
+    }
+
+    // Fee and size of every not-yet-included transaction together with its
+    // not-yet-included ancestors. Updated incrementally as transactions are
+    // picked, so each transaction is only ever subtracted once per descendant.
+    std::vector<CAmount> anc_fee(n, 0);
+    std::vector<int64_t> anc_size(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j <= i; ++j) {
+            if (!((ancestors[i] >> j) & 1)) continue;
+            anc_fee[i] += topo[j]->GetModifiedFee();
+            anc_size[i] += topo[j]->GetTxSize();
+        }
+    }
+
+    // Repeatedly pick the remaining transaction with the best ancestor feerate
+    // and append it together with its remaining ancestors, in topological order.
+    uint64_t included{0};
+    std::vector<size_t> order;
+    order.reserve(n);
+    while (order.size() < n) {
+        size_t best = n;
+        for (size_t i = 0; i < n; ++i) {
+            if ((included >> i) & 1) continue;
+            if (best == n) {
+                best = i;
+                continue;
+            }
+            // Compare anc_fee[i]/anc_size[i] against anc_fee[best]/anc_size[best].
+            const double lhs = double(anc_fee[i]) * anc_size[best];
+            const double rhs = double(anc_fee[best]) * anc_size[i];
+            if (lhs > rhs || (lhs == rhs && anc_size[i] < anc_size[best])) best = i;
+        }
+        for (size_t j = 0; j <= best; ++j) {
+            if (((included >> j) & 1) || !((ancestors[best] >> j) & 1)) continue;
+            included |= uint64_t{1} << j;
+            order.push_back(j);
+            for (size_t k = j + 1; k < n; ++k) {
+                if (((included >> k) & 1) || !((ancestors[k] >> j) & 1)) continue;
+                anc_fee[k] -= topo[j]->GetModifiedFee();
+                anc_size[k] -= topo[j]->GetTxSize();
+            }
+        }
+    }
+
+    // Merge adjacent groups whenever a later one has a higher feerate than the
+    // one before it, which yields chunks with non-increasing feerates.
+    std::vector<ClusterChunk> chunks;
+    for (const size_t i : order) {
+        chunks.emplace_back();
+        chunks.back().fee = topo[i]->GetModifiedFee();
+        chunks.back().size = topo[i]->GetTxSize();
+        chunks.back().txs.push_back(topo[i]);
+        while (chunks.size() > 1) {
+            ClusterChunk& last = chunks[chunks.size() - 1];
+            ClusterChunk& prev = chunks[chunks.size() - 2];
+            if (double(last.fee) * prev.size <= double(prev.fee) * last.size) break;
+            prev.fee += last.fee;
+            prev.size += last.size;
+            prev.txs.insert(prev.txs.end(), last.txs.begin(), last.txs.end());
+            chunks.pop_back();
+        }
+    }
+    return chunks;
+}
+
 void CTxMemPool::removeRecursive(const CTransaction &origTx, MemPoolRemovalReason reason)
 {
     // Remove transaction from memory pool
@@ -570,6 +686,8 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
     }
     // Before the txs in the new block have been removed from the mempool, update policy estimates
     if (minerPolicyEstimator) {minerPolicyEstimator->processBlock(nBlockHeight, entries);}
+    // Descendants of the mined transactions lose ancestors.
+    ++m_relay_order_epoch;
     for (const auto& tx : vtx)
     {
         txiter it = mapTx.find(tx->GetHash());
@@ -633,7 +751,7 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
         checkTotal += it->GetTxSize();
         innerUsage += it->DynamicMemoryUsage();
         const CTransaction& tx = it->GetTx();
-        innerUsage += memusage::DynamicUsage(it->GetMemPoolParentsConst()) + memusage::DynamicUsage(it->GetMemPoolChildrenConst());
+        innerUsage += it->GetMemPoolParentsConst().DynamicMemoryUsage() + it->GetMemPoolChildrenConst().DynamicMemoryUsage();
         bool fDependsWait = false;
         CTxMemPoolEntry::Parents setParentCheck;
         for (const CTxIn &txin : tx.vin) {
@@ -743,6 +861,31 @@ bool CTxMemPool::CompareDepthAndScore(const uint256& hasha, const uint256& hashb
     return counta < countb;
 }
 
+Optional<TxRelayOrderKey> CTxMemPool::GetRelayOrderKey(const uint256& hash, bool wtxid) const
+{
+    LOCK(cs);
+    indexed_transaction_set::const_iterator i = wtxid ? get_iter_from_wtxid(hash) : mapTx.find(hash);
+    if (i == mapTx.end()) return nullopt;
+    return TxRelayOrderKey{i->GetCountWithAncestors(), i->GetFee(), i->GetTxSize(), i->GetTx().GetHash()};
+}
+
+std::vector<Optional<TxRelayOrderKey>> CTxMemPool::GetRelayOrderKeys(const std::vector<uint256>& txids, uint64_t& epoch) const
+{
+    std::vector<Optional<TxRelayOrderKey>> keys;
+    keys.reserve(txids.size());
+    LOCK(cs);
+    epoch = m_relay_order_epoch;
+    for (const uint256& txid : txids) {
+        indexed_transaction_set::const_iterator i = mapTx.find(txid);
+        if (i == mapTx.end()) {
+            keys.emplace_back(nullopt);
+        } else {
+            keys.emplace_back(TxRelayOrderKey{i->GetCountWithAncestors(), i->GetFee(), i->GetTxSize(), i->GetTx().GetHash()});
+        }
+    }
+    return keys;
+}
+
 namespace {
 class DepthAndScoreComparator
 {
@@ -804,6 +947,80 @@ std::vector<TxMempoolInfo> CTxMemPool::infoAll() const
     return ret;
 }
 
+static TxMempoolEntrySnapshot GetEntrySnapshotUnlocked(const CTxMemPoolEntry& e, const uint256& wtxid, bool unbroadcast)
+{
+    TxMempoolEntrySnapshot snapshot{e.GetSharedTx(), wtxid, e.GetFee(), e.GetModifiedFee(), e.GetTxSize(), e.GetTxWeight(),
+                                    e.GetTime(), e.GetHeight(),
+                                    e.GetCountWithDescendants(), e.GetSizeWithDescendants(), e.GetModFeesWithDescendants(),
+                                    e.GetCountWithAncestors(), e.GetSizeWithAncestors(), e.GetModFeesWithAncestors(),
+                                    {}, {}, /* bip125_replaceable */ false, unbroadcast};
+    snapshot.parents.reserve(e.GetMemPoolParentsConst().size());
+    for (const CTxMemPoolEntry& parent : e.GetMemPoolParentsConst()) {
+        snapshot.parents.push_back(parent.GetTx().GetHash());
+    }
+    snapshot.children.reserve(e.GetMemPoolChildrenConst().size());
+    for (const CTxMemPoolEntry& child : e.GetMemPoolChildrenConst()) {
+        snapshot.children.push_back(child.GetTx().GetHash());
+    }
+    return snapshot;
+}
+
+TxMempoolEntrySnapshot CTxMemPool::GetEntrySnapshot(txiter it) const
+{
+    AssertLockHeld(cs);
+    TxMempoolEntrySnapshot snapshot{GetEntrySnapshotUnlocked(*it, vTxHashes[it->vTxHashesIdx].first, IsUnbroadcastTx(it->GetTx().GetHash()))};
+
+    snapshot.bip125_replaceable = SignalsOptInRBF(it->GetTx());
+    if (!snapshot.bip125_replaceable) {
+        setEntries ancestors;
+        uint64_t no_limit = std::numeric_limits<uint64_t>::max();
+        std::string dummy;
+        CalculateMemPoolAncestors(*it, ancestors, no_limit, no_limit, no_limit, no_limit, dummy, false);
+        for (txiter ancestor : ancestors) {
+            if (SignalsOptInRBF(ancestor->GetTx())) {
+                snapshot.bip125_replaceable = true;
+                break;
+            }
+        }
+    }
+    return snapshot;
+}
+
+std::vector<TxMempoolEntrySnapshot> CTxMemPool::GetEntrySnapshots() const
+{
+    std::vector<TxMempoolEntrySnapshot> ret;
+    {
+        LOCK(cs);
+        ret.reserve(mapTx.size());
+        for (const CTxMemPoolEntry& e : mapTx) {
+            ret.push_back(GetEntrySnapshotUnlocked(e, vTxHashes[e.vTxHashesIdx].first, IsUnbroadcastTx(e.GetTx().GetHash())));
+        }
+    }
+
+    // A transaction is replaceable if it or any of its in-mempool ancestors
+    // signals, which is the case if it signals or any of its parents is
+    // replaceable. Visit the entries in order of ancestor count, so that all
+    // parents are resolved before their children.
+    std::vector<size_t> order(ret.size());
+    std::unordered_map<uint256, size_t, SaltedTxidHasher> index_by_txid;
+    index_by_txid.reserve(ret.size());
+    for (size_t i = 0; i < ret.size(); ++i) {
+        order[i] = i;
+        index_by_txid.emplace(ret[i].tx->GetHash(), i);
+    }
+    std::sort(order.begin(), order.end(), [&ret](size_t a, size_t b) {
+        return ret[a].count_with_ancestors < ret[b].count_with_ancestors;
+    });
+    for (size_t i : order) {
+        TxMempoolEntrySnapshot& snapshot = ret[i];
+        snapshot.bip125_replaceable = SignalsOptInRBF(*snapshot.tx);
+        for (auto parent = snapshot.parents.begin(); !snapshot.bip125_replaceable && parent != snapshot.parents.end(); ++parent) {
+            snapshot.bip125_replaceable = ret[index_by_txid.at(*parent)].bip125_replaceable;
+        }
+    }
+    return ret;
+}
+
 CTransactionRef CTxMemPool::get(const uint256& hash) const
 {
     LOCK(cs);
@@ -916,9 +1133,22 @@ bool CCoinsViewMemPool::GetCoin(const COutPoint &outpoint, Coin &coin) const {
             return false;
         }
     }
+    // Outputs of transactions being validated in the same package, which are not in the mempool yet.
+    const auto it = m_temp_added.find(outpoint);
+    if (it != m_temp_added.end()) {
+        coin = it->second;
+        return true;
+    }
     return base->GetCoin(outpoint, coin);
 }
 
+void CCoinsViewMemPool::PackageAddTransaction(const CTransactionRef& tx)
+{
+    for (unsigned int n = 0; n < tx->vout.size(); ++n) {
+        m_temp_added.emplace(COutPoint(tx->GetHash(), n), Coin(tx->vout[n], MEMPOOL_HEIGHT, false));
+    }
+}
+
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
     // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
@@ -971,23 +1201,27 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, bool validFeeEstimat
 void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
 {
     AssertLockHeld(cs);
-    CTxMemPoolEntry::Children s;
-    if (add && entry->GetMemPoolChildren().insert(*child).second) {
-        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
-    } else if (!add && entry->GetMemPoolChildren().erase(*child)) {
-        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    CTxMemPoolEntry::Children& children = entry->GetMemPoolChildren();
+    cachedInnerUsage -= children.DynamicMemoryUsage();
+    if (add) {
+        children.insert(*child);
+    } else {
+        children.erase(*child);
     }
+    cachedInnerUsage += children.DynamicMemoryUsage();
 }
 
 void CTxMemPool::UpdateParent(txiter entry, txiter parent, bool add)
 {
     AssertLockHeld(cs);
-    CTxMemPoolEntry::Parents s;
-    if (add && entry->GetMemPoolParents().insert(*parent).second) {
-        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
-    } else if (!add && entry->GetMemPoolParents().erase(*parent)) {
-        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    CTxMemPoolEntry::Parents& parents = entry->GetMemPoolParents();
+    cachedInnerUsage -= parents.DynamicMemoryUsage();
+    if (add) {
+        parents.insert(*parent);
+    } else {
+        parents.erase(*parent);
     }
+    cachedInnerUsage += parents.DynamicMemoryUsage();
 }
 
 CFeeRate CTxMemPool::GetMinFee(size_t sizelimit) const {
@@ -6,10 +6,13 @@
 #ifndef BITCOIN_TXMEMPOOL_H
 #define BITCOIN_TXMEMPOOL_H
 
+#include <algorithm>
 #include <atomic>
+#include <functional>
 #include <map>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -17,8 +20,10 @@
 #include <coins.h>
 #include <crypto/siphash.h>
 #include <indirectmap.h>
+#include <memusage.h>
 #include <optional.h>
 #include <policy/feerate.h>
+#include <prevector.h>
 #include <primitives/transaction.h>
 #include <sync.h>
 #include <random.h>
@@ -34,6 +39,9 @@ extern RecursiveMutex cs_main;
 /** Fake height value used in Coin to signify they are only in the memory pool (since 0.8) */
 static const uint32_t MEMPOOL_HEIGHT = 0x7FFFFFFF;
 
+/** Largest cluster CTxMemPool::LinearizeCluster() is applied to. */
+static const size_t MAX_LINEARIZED_CLUSTER_SIZE = 64;
+
 struct LockPoints
 {
     // Will be set to the blockchain height and median time past
@@ -63,6 +71,78 @@ struct CompareIteratorByHash {
         return a->GetTx().GetHash() < b->GetTx().GetHash();
     }
 };
+
+/**
+ * Set of references to mempool entries, ordered by Compare.
+ *
+ * Most mempool entries have at most a handful of in-mempool parents and
+ * children. Rather than a node-based std::set (one allocation of several
+ * pointers per element), the entries' addresses are kept in a sorted flat
+ * array, with room for a single one inline. Lookups are binary searches,
+ * insertions and removals move the elements after the affected position.
+ */
+template <typename T, typename Compare>
+class SortedRefSet
+{
+    typedef prevector<1, T*> vector_type;
+    vector_type m_ptrs;
+
+    typename vector_type::iterator lower_bound(T* ptr) { return std::lower_bound(m_ptrs.begin(), m_ptrs.end(), ptr, Compare()); }
+    typename vector_type::const_iterator lower_bound(T* ptr) const { return std::lower_bound(m_ptrs.begin(), m_ptrs.end(), ptr, Compare()); }
+
+public:
+    typedef std::reference_wrapper<T> value_type;
+
+    class const_iterator
+    {
+        typename vector_type::const_iterator m_it;
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef T* pointer;
+        typedef T& reference;
+
+        explicit const_iterator(typename vector_type::const_iterator it) : m_it(it) {}
+        T& operator*() const { return **m_it; }
+        T* operator->() const { return *m_it; }
+        const_iterator& operator++() { ++m_it; return *this; }
+        const_iterator operator++(int) { const_iterator copy(*this); ++m_it; return copy; }
+        bool operator==(const const_iterator& other) const { return m_it == other.m_it; }
+        bool operator!=(const const_iterator& other) const { return m_it != other.m_it; }
+    };
+    typedef const_iterator iterator;
+
+    const_iterator begin() const { return const_iterator(m_ptrs.begin()); }
+    const_iterator end() const { return const_iterator(m_ptrs.end()); }
+    size_t size() const { return m_ptrs.size(); }
+    bool empty() const { return m_ptrs.empty(); }
+
+    std::pair<const_iterator, bool> insert(value_type ref)
+    {
+        auto it = lower_bound(&ref.get());
+        if (it != m_ptrs.end() && !Compare()(&ref.get(), *it)) return {const_iterator(it), false};
+        return {const_iterator(m_ptrs.insert(it, &ref.get())), true};
+    }
+
+    size_t erase(value_type ref)
+    {
+        auto it = lower_bound(&ref.get());
+        if (it == m_ptrs.end() || Compare()(&ref.get(), *it)) return 0;
+        m_ptrs.erase(it);
+        return 1;
+    }
+
+    size_t count(value_type ref) const
+    {
+        auto it = lower_bound(&ref.get());
+        return it != m_ptrs.end() && !Compare()(&ref.get(), *it);
+    }
+
+    size_t DynamicMemoryUsage() const { return memusage::DynamicUsage(m_ptrs); }
+};
+
 /** \class CTxMemPoolEntry
  *
  * CTxMemPoolEntry stores data about the corresponding transaction, as well
@@ -80,19 +160,18 @@ class CTxMemPoolEntry
 public:
     typedef std::reference_wrapper<const CTxMemPoolEntry> CTxMemPoolEntryRef;
     // two aliases, should the types ever diverge
-    typedef std::set<CTxMemPoolEntryRef, CompareIteratorByHash> Parents;
-    typedef std::set<CTxMemPoolEntryRef, CompareIteratorByHash> Children;
+    typedef SortedRefSet<const CTxMemPoolEntry, CompareIteratorByHash> Parents;
+    typedef SortedRefSet<const CTxMemPoolEntry, CompareIteratorByHash> Children;
 
 private:
+    // Members are ordered by size to avoid padding, as there is one entry per
+    // mempool transaction.
     const CTransactionRef tx;
     mutable Parents m_parents;
     mutable Children m_children;
     const CAmount nFee;             //!< Cached to avoid expensive parent-transaction lookups
-    const size_t nTxWeight;         //!< ... and avoid recomputing tx weight (also used for GetTxSize())
     const size_t nUsageSize;        //!< ... and total memory usage
     const int64_t nTime;            //!< Local time when entering the mempool
-    const unsigned int entryHeight; //!< Chain height when entering the mempool
-    const bool spendsCoinbase;      //!< keep track of transactions that spend a coinbase
     const int64_t sigOpCost;        //!< Total sigop cost
     int64_t feeDelta;          //!< Used for determining the priority of the transaction for mining in a block
     LockPoints lockPoints;     //!< Track the height and time at which tx was final
@@ -110,6 +189,10 @@ private:
     CAmount nModFeesWithAncestors;
     int64_t nSigOpCostWithAncestors;
 
+    const int32_t nTxWeight;        //!< Cached to avoid recomputing tx weight (also used for GetTxSize())
+    const unsigned int entryHeight; //!< Chain height when entering the mempool
+    const bool spendsCoinbase;      //!< keep track of transactions that spend a coinbase
+
 public:
     CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                     int64_t _nTime, unsigned int _entryHeight,
@@ -386,6 +469,61 @@ struct TxMempoolInfo
     int64_t nFeeDelta;
 };
 
+/**
+ * Copy of the per-entry state reported by the mempool RPCs. Taking these copies
+ * only needs cs for as long as the copy itself, so that (potentially large)
+ * responses can be serialized without blocking the mempool.
+ */
+struct TxMempoolEntrySnapshot
+{
+    CTransactionRef tx;
+    uint256 wtxid;
+    CAmount fee;
+    CAmount modified_fee;
+    size_t vsize;
+    size_t weight;
+    std::chrono::seconds time;
+    unsigned int height;
+    uint64_t count_with_descendants;
+    uint64_t size_with_descendants;
+    CAmount mod_fees_with_descendants;
+    uint64_t count_with_ancestors;
+    uint64_t size_with_ancestors;
+    CAmount mod_fees_with_ancestors;
+    /** In-mempool parents and children of the transaction. */
+    std::vector<uint256> parents;
+    std::vector<uint256> children;
+    /** Whether the transaction or any of its in-mempool ancestors signals BIP125 replaceability. */
+    bool bip125_replaceable;
+    bool unbroadcast;
+};
+
+/**
+ * The data CTxMemPool::CompareDepthAndScore() orders transactions by, so that
+ * announcements can be ordered without looking up the mempool on every comparison.
+ */
+struct TxRelayOrderKey
+{
+    uint64_t m_count_with_ancestors;
+    CAmount m_fee;
+    size_t m_vsize;
+    uint256 m_txid;
+
+    /** Same order as CompareDepthAndScore(): fewest ancestors first, then highest feerate. */
+    bool operator<(const TxRelayOrderKey& other) const
+    {
+        if (m_count_with_ancestors != other.m_count_with_ancestors) {
+            return m_count_with_ancestors < other.m_count_with_ancestors;
+        }
+        double f1 = (double)m_fee * other.m_vsize;
+        double f2 = (double)other.m_fee * m_vsize;
+        if (f1 == f2) {
+            return other.m_txid < m_txid;
+        }
+        return f1 > f2;
+    }
+};
+
 /** Reason why a transaction was removed from the mempool,
  * this is passed to the notification signal.
  */
@@ -490,6 +628,7 @@ class CTxMemPool
 private:
     const int m_check_ratio; //!< Value n means that 1 times in n we check.
     std::atomic<unsigned int> nTransactionsUpdated{0}; //!< Used by getblocktemplate to trigger CreateNewBlock() invocation
+    std::atomic<uint64_t> m_relay_order_epoch{0}; //!< Bumped (under cs) whenever the TxRelayOrderKey of a transaction left in the mempool changes
     CBlockPolicyEstimator* minerPolicyEstimator;
 
     uint64_t totalTxSize;      //!< sum of all mempool tx's virtual sizes. Differs from serialized tx size since witness data is discounted. Defined in BIP 141.
@@ -636,6 +775,19 @@ public:
     void clear();
     void _clear() EXCLUSIVE_LOCKS_REQUIRED(cs); //lock free
     bool CompareDepthAndScore(const uint256& hasha, const uint256& hashb, bool wtxid=false);
+    /** The key CompareDepthAndScore() orders a transaction by, or nullopt if it is not in the mempool. */
+    Optional<TxRelayOrderKey> GetRelayOrderKey(const uint256& hash, bool wtxid=false) const;
+    /**
+     * The keys of all given txids (nullopt for those not in the mempool), looked
+     * up under a single lock, along with the relay order epoch they are valid for.
+     */
+    std::vector<Optional<TxRelayOrderKey>> GetRelayOrderKeys(const std::vector<uint256>& txids, uint64_t& epoch) const;
+    /**
+     * Changes whenever the key of a transaction that stays in the mempool may
+     * have changed, i.e. when one of its ancestors is mined or when a reorg
+     * gives it new in-mempool ancestors. Keys obtained for an older epoch are stale.
+     */
+    uint64_t GetRelayOrderEpoch() const { return m_relay_order_epoch; }
     void queryHashes(std::vector<uint256>& vtxid) const;
     bool isSpent(const COutPoint& outpoint) const;
     unsigned int GetTransactionsUpdated() const;
@@ -697,6 +849,30 @@ public:
      *  already in it.  */
     void CalculateDescendants(txiter it, setEntries& setDescendants) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    /** A run of consecutive transactions in a cluster linearization, see LinearizeCluster(). */
+    struct ClusterChunk {
+        CAmount fee{0};     //!< Sum of modified fees of txs
+        int64_t size{0};    //!< Sum of virtual sizes of txs
+        std::vector<txiter> txs;
+    };
+
+    /** Return the cluster of it: all in-mempool transactions connected to it
+     *  through any chain of parent and child links, including it itself.
+     *  Returns nullopt if it has more than MAX_LINEARIZED_CLUSTER_SIZE
+     *  transactions. */
+    Optional<std::vector<txiter>> GatherCluster(txiter it) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    /** Linearize a cluster (as returned by GatherCluster()) into a topologically
+     *  valid order, by repeatedly appending the remaining transaction with the
+     *  highest ancestor feerate together with its remaining ancestors, like
+     *  block assembly does. This is a heuristic; the result is not necessarily
+     *  the most profitable order. The order is then split into chunks of
+     *  non-increasing feerate. The last chunk is a set of transactions that
+     *  includes all its in-mempool descendants, so it could be evicted as a
+     *  whole. Runs in O(n^2) for a cluster of n transactions.
+     */
+    std::vector<ClusterChunk> LinearizeCluster(const std::vector<txiter>& cluster) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
     /** The minimum fee to get into the mempool, which may itself not be enough
       *  for larger-sized transactions.
       *  The incrementalRelayFee policy variable is used to bound the time it
@@ -758,6 +934,14 @@ public:
     TxMempoolInfo info(const GenTxid& gtxid) const;
     std::vector<TxMempoolInfo> infoAll() const;
 
+    /** Copy the RPC-visible state of a single entry. */
+    TxMempoolEntrySnapshot GetEntrySnapshot(txiter it) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /**
+     * Copy the RPC-visible state of all entries. cs is only held while copying;
+     * BIP125 replaceability is derived from the copies after it is released.
+     */
+    std::vector<TxMempoolEntrySnapshot> GetEntrySnapshots() const;
+
     size_t DynamicMemoryUsage() const;
 
     /** Adds a transaction to the unbroadcast set */
@@ -897,12 +1081,20 @@ public:
  */
 class CCoinsViewMemPool : public CCoinsViewBacked
 {
+    /**
+    * Coins made available by transactions being validated. Tracking these allows for package
+    * validation, since we can access transaction outputs without submitting them to mempool.
+    */
+    std::unordered_map<COutPoint, Coin, SaltedOutpointHasher> m_temp_added;
 protected:
     const CTxMemPool& mempool;
 
 public:
     CCoinsViewMemPool(CCoinsView* baseIn, const CTxMemPool& mempoolIn);
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    /** Add the coins created by this transaction. These coins are only temporarily stored in
+     * m_temp_added and cannot be flushed to the back end. Only used for package validation. */
+    void PackageAddTransaction(const CTransactionRef& tx);
 };
 
 /**
@@ -48,7 +48,9 @@
 #include <validationinterface.h>
 #include <warnings.h>
 
+#include <deque>
 #include <string>
+#include <tuple>
 
 #include <boost/algorithm/string/replace.hpp>
 
@@ -196,6 +198,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 std::unique_ptr<CBlockTreeDB> pblocktree;
 
 bool CheckInputScripts(const CTransaction& tx, TxValidationState &state, const CCoinsViewCache &inputs, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks = nullptr);
+static bool RunScriptChecksInParallel(std::vector<CScriptCheck>& checks, CScriptCheck* failed_check = nullptr);
 static FILE* OpenUndoFile(const FlatFilePos &pos, bool fReadOnly = false);
 static FlatFileSeq BlockFileSeq();
 static FlatFileSeq UndoFileSeq();
@@ -250,7 +253,7 @@ bool TestLockPointValidity(const LockPoints* lp)
     return true;
 }
 
-bool CheckSequenceLocks(const CTxMemPool& pool, const CTransaction& tx, int flags, LockPoints* lp, bool useExistingLockPoints)
+bool CheckSequenceLocks(const CTxMemPool& pool, const CTransaction& tx, int flags, LockPoints* lp, bool useExistingLockPoints, const CCoinsView* coins_view)
 {
     AssertLockHeld(cs_main);
     AssertLockHeld(pool.cs);
@@ -277,12 +280,13 @@ bool CheckSequenceLocks(const CTxMemPool& pool, const CTransaction& tx, int flag
     else {
         // CoinsTip() contains the UTXO set for ::ChainActive().Tip()
         CCoinsViewMemPool viewMemPool(&::ChainstateActive().CoinsTip(), pool);
+        const CCoinsView& view = coins_view ? *coins_view : viewMemPool;
         std::vector<int> prevheights;
         prevheights.resize(tx.vin.size());
         for (size_t txinIndex = 0; txinIndex < tx.vin.size(); txinIndex++) {
             const CTxIn& txin = tx.vin[txinIndex];
             Coin coin;
-            if (!viewMemPool.GetCoin(txin.prevout, coin)) {
+            if (!view.GetCoin(txin.prevout, coin)) {
                 return error("%s: Missing input", __func__);
             }
             if (coin.nHeight == MEMPOOL_HEIGHT) {
@@ -405,9 +409,10 @@ static void UpdateMempoolForReorg(CTxMemPool& mempool, DisconnectedBlockTransact
 }
 
 // Used to avoid mempool polluting consensus critical paths if CCoinsViewMempool
-// were somehow broken and returning the wrong scriptPubKeys
+// were somehow broken and returning the wrong scriptPubKeys. Inputs may also
+// spend package_txns, the not yet added transactions of the same package.
 static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, TxValidationState& state, const CCoinsViewCache& view, const CTxMemPool& pool,
-                 unsigned int flags, PrecomputedTransactionData& txdata) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+                 const std::map<uint256, CTransactionRef>& package_txns, unsigned int flags, PrecomputedTransactionData& txdata) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
     AssertLockHeld(cs_main);
 
     // pool.cs should be locked already, but go ahead and re-take the lock here
@@ -425,7 +430,11 @@ static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, TxValidationS
         if (coin.IsSpent()) return false;
 
         // Check equivalence for available inputs.
-        const CTransactionRef& txFrom = pool.get(txin.prevout.hash);
+        CTransactionRef txFrom = pool.get(txin.prevout.hash);
+        if (!txFrom) {
+            const auto it = package_txns.find(txin.prevout.hash);
+            if (it != package_txns.end()) txFrom = it->second;
+        }
         if (txFrom) {
             assert(txFrom->GetHash() == txin.prevout.hash);
             assert(txFrom->vout.size() > txin.prevout.n);
@@ -470,11 +479,20 @@ public:
         std::vector<COutPoint>& m_coins_to_uncache;
         const bool m_test_accept;
         CAmount* m_fee_out;
+        /** Whether to allow replacing mempool transactions (BIP 125). */
+        const bool m_allow_bip125_replacement{true};
+        /** Whether the feerate is checked for the package this transaction belongs to,
+         *  as a whole, instead of for the transaction alone. */
+        const bool m_package_feerate{false};
     };
 
     // Single transaction acceptance
     bool AcceptSingleTransaction(const CTransactionRef& ptx, ATMPArgs& args) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    // Multiple transaction acceptance, see ProcessNewPackage()
+    PackageMempoolAcceptResult AcceptMultipleTransactions(const Package& txns, const CChainParams& chainparams, int64_t accept_time,
+                                                          std::vector<COutPoint>& coins_to_uncache, bool test_accept) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 private:
     // All the intermediate state that gets passed between the various levels
     // of checking a given transaction.
@@ -511,10 +529,24 @@ private:
     bool ConsensusScriptChecks(ATMPArgs& args, const Workspace& ws, PrecomputedTransactionData &txdata) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Try to add the transaction to the mempool, removing any conflicts first.
-    // Returns true if the transaction is in the mempool after any size
-    // limiting is performed, false otherwise.
+    // Returns true if the transaction was added. The caller is responsible for
+    // limiting the mempool size afterwards.
     bool Finalize(ATMPArgs& args, Workspace& ws) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs);
 
+    // Limit the mempool size (unless bypass_limits), evicting the lowest feerate
+    // packages.
+    void LimitMempool(bool bypass_limits) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs)
+    {
+        if (bypass_limits) return;
+        LimitMempoolSize(m_pool, gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, std::chrono::hours{gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY)});
+    }
+
+    // Enforce the ancestor and descendant limits on the package as a whole, on top of
+    // the limits PreChecks() enforced for each transaction (which could not see the
+    // in-package ancestors). Conservatively treats the package as one transaction
+    // with the union of the in-mempool ancestors of all package transactions.
+    bool CheckPackageLimits(const std::vector<Workspace>& workspaces, PackageValidationState& package_state) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs);
+
     // Compare a package's feerate against minimum allowed.
     bool CheckFeeRate(size_t package_size, CAmount package_fee, TxValidationState& state)
     {
@@ -534,6 +566,9 @@ private:
     CCoinsViewCache m_view;
     CCoinsViewMemPool m_viewmempool;
     CCoinsView m_dummy;
+    // The transactions of the package being validated, by txid, whose outputs
+    // were made available to m_viewmempool with PackageAddTransaction().
+    std::map<uint256, CTransactionRef> m_package_txns;
 
     // The package limits in effect at the time of invocation.
     const size_t m_limit_ancestors;
@@ -628,6 +663,9 @@ bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
                 if (fReplacementOptOut) {
                     return state.Invalid(TxValidationResult::TX_MEMPOOL_POLICY, "txn-mempool-conflict");
                 }
+                if (!args.m_allow_bip125_replacement) {
+                    return state.Invalid(TxValidationResult::TX_MEMPOOL_POLICY, "bip125-replacement-disallowed");
+                }
 
                 setConflicts.insert(ptxConflicting->GetHash());
             }
@@ -671,9 +709,10 @@ bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
     // Only accept BIP68 sequence locked transactions that can be mined in the next
     // block; we don't want our mempool filled up with transactions that can't
     // be mined yet.
-    // Must keep pool.cs for this unless we change CheckSequenceLocks to take a
-    // CoinsViewCache instead of create its own
-    if (!CheckSequenceLocks(m_pool, tx, STANDARD_LOCKTIME_VERIFY_FLAGS, &lp))
+    // Must keep pool.cs for this unless we change CheckSequenceLocks to not
+    // depend on the mempool. The coins are looked up in m_view, which also
+    // holds the outputs of preceding package transactions.
+    if (!CheckSequenceLocks(m_pool, tx, STANDARD_LOCKTIME_VERIFY_FLAGS, &lp, /* useExistingLockPoints */ false, &m_view))
         return state.Invalid(TxValidationResult::TX_PREMATURE_SPEND, "non-BIP68-final");
 
     CAmount nFees = 0;
@@ -723,8 +762,8 @@ bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
                 strprintf("%d", nSigOpsCost));
 
     // No transactions are allowed below minRelayTxFee except from disconnected
-    // blocks
-    if (!bypass_limits && !CheckFeeRate(nSize, nModifiedFees, state)) return false;
+    // blocks (or as part of a package which meets it as a whole)
+    if (!bypass_limits && !args.m_package_feerate && !CheckFeeRate(nSize, nModifiedFees, state)) return false;
 
     const CTxMemPool::setEntries setIterConflicting = m_pool.GetIterSet(setConflicts);
     // Calculate in-mempool ancestors, up to a limit.
@@ -969,7 +1008,7 @@ bool MemPoolAccept::ConsensusScriptChecks(ATMPArgs& args, const Workspace& ws, P
     // invalid blocks (using TestBlockValidity), however allowing such
     // transactions into the mempool can be exploited as a DoS attack.
     unsigned int currentBlockScriptVerifyFlags = GetBlockScriptFlags(::ChainActive().Tip(), chainparams.GetConsensus());
-    if (!CheckInputsFromMempoolAndCache(tx, state, m_view, m_pool, currentBlockScriptVerifyFlags, txdata)) {
+    if (!CheckInputsFromMempoolAndCache(tx, state, m_view, m_pool, m_package_txns, currentBlockScriptVerifyFlags, txdata)) {
         return error("%s: BUG! PLEASE REPORT THIS! CheckInputScripts failed against latest-block but not STANDARD flags %s, %s",
                 __func__, hash.ToString(), state.ToString());
     }
@@ -981,7 +1020,6 @@ bool MemPoolAccept::Finalize(ATMPArgs& args, Workspace& ws)
 {
     const CTransaction& tx = *ws.m_ptx;
     const uint256& hash = ws.m_hash;
-    TxValidationState &state = args.m_state;
     const bool bypass_limits = args.m_bypass_limits;
 
     CTxMemPool::setEntries& allConflicting = ws.m_all_conflicting;
@@ -1014,12 +1052,32 @@ bool MemPoolAccept::Finalize(ATMPArgs& args, Workspace& ws)
 
     // Store transaction in memory
     m_pool.addUnchecked(*entry, setAncestors, validForFeeEstimation);
+    return true;
+}
 
-    // trim mempool and check if tx was trimmed
-    if (!bypass_limits) {
-        LimitMempoolSize(m_pool, gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, std::chrono::hours{gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY)});
-        if (!m_pool.exists(hash))
-            return state.Invalid(TxValidationResult::TX_MEMPOOL_POLICY, "mempool full");
+bool MemPoolAccept::CheckPackageLimits(const std::vector<Workspace>& workspaces, PackageValidationState& package_state)
+{
+    CTxMemPool::setEntries ancestors;
+    uint64_t package_size{0};
+    for (const Workspace& ws : workspaces) {
+        ancestors.insert(ws.m_ancestors.begin(), ws.m_ancestors.end());
+        package_size += ws.m_entry->GetTxSize();
+    }
+
+    uint64_t ancestor_size{package_size};
+    for (const CTxMemPool::txiter it : ancestors) {
+        ancestor_size += it->GetTxSize();
+    }
+    if (ancestors.size() + workspaces.size() > m_limit_ancestors || ancestor_size > m_limit_ancestor_size) {
+        return package_state.Invalid(PackageValidationResult::PCKG_POLICY, "package-mempool-limits",
+                                     strprintf("exceeds ancestor limits (%u txs, %u bytes)", ancestors.size() + workspaces.size(), ancestor_size));
+    }
+    for (const CTxMemPool::txiter it : ancestors) {
+        if (it->GetCountWithDescendants() + workspaces.size() > m_limit_descendants ||
+            it->GetSizeWithDescendants() + package_size > m_limit_descendant_size) {
+            return package_state.Invalid(PackageValidationResult::PCKG_POLICY, "package-mempool-limits",
+                                         strprintf("exceeds descendant limits of %s", it->GetTx().GetHash().ToString()));
+        }
     }
     return true;
 }
@@ -1048,11 +1106,144 @@ bool MemPoolAccept::AcceptSingleTransaction(const CTransactionRef& ptx, ATMPArgs
 
     if (!Finalize(args, workspace)) return false;
 
+    // trim mempool and check if tx was trimmed
+    LimitMempool(args.m_bypass_limits);
+    if (!m_pool.exists(workspace.m_hash)) {
+        return args.m_state.Invalid(TxValidationResult::TX_MEMPOOL_POLICY, "mempool full");
+    }
+
     GetMainSignals().TransactionAddedToMempool(ptx, m_pool.GetAndIncrementSequence());
 
     return true;
 }
 
+PackageMempoolAcceptResult MemPoolAccept::AcceptMultipleTransactions(const Package& txns, const CChainParams& chainparams, int64_t accept_time,
+                                                                     std::vector<COutPoint>& coins_to_uncache, bool test_accept)
+{
+    AssertLockHeld(cs_main);
+
+    PackageMempoolAcceptResult result;
+    PackageValidationState& package_state = result.m_state;
+    if (!CheckPackage(txns, package_state)) return result;
+
+    // Only a child with all of its parents may pay for them; otherwise every
+    // transaction has to meet the minimum feerate on its own.
+    const bool package_feerate = IsChildWithParents(txns);
+
+    // Per-transaction state. Sized up front, as ATMPArgs holds references into it.
+    std::vector<TxValidationState> tx_states(txns.size());
+    std::vector<CAmount> tx_fees(txns.size(), 0);
+    const auto make_args = [&](size_t i) {
+        return ATMPArgs{chainparams, tx_states[i], accept_time, /* m_replaced_transactions */ nullptr, /* m_bypass_limits */ false,
+                        coins_to_uncache, test_accept, &tx_fees[i], /* m_allow_bip125_replacement */ false, package_feerate};
+    };
+    const auto fail_tx = [&](size_t i) {
+        package_state.Invalid(PackageValidationResult::PCKG_TX, "transaction failed");
+        result.m_tx_results.emplace(txns[i]->GetWitnessHash(), MempoolAcceptResult{tx_states[i], nullopt});
+        return result;
+    };
+
+    LOCK(m_pool.cs); // mempool "read lock" (held through GetMainSignals().TransactionAddedToMempool())
+
+    // Transactions already in the mempool are not validated again. The others
+    // can spend their outputs through the mempool, and they are left out of the
+    // package feerate like any other in-mempool ancestor.
+    std::vector<size_t> new_txns;
+    std::vector<Workspace> workspaces;
+    workspaces.reserve(txns.size());
+    for (size_t i = 0; i < txns.size(); ++i) {
+        const auto it = m_pool.GetIter(txns[i]->GetHash());
+        if (it && (*it)->GetTx().GetWitnessHash() == txns[i]->GetWitnessHash()) {
+            result.m_tx_results.emplace(txns[i]->GetWitnessHash(), MempoolAcceptResult{tx_states[i], (*it)->GetFee()});
+            continue;
+        }
+        ATMPArgs args = make_args(i);
+        workspaces.emplace_back(txns[i]);
+        if (!PreChecks(args, workspaces.back())) return fail_tx(i);
+        // Make the coins created by this transaction available for subsequent
+        // transactions in the package to spend.
+        m_viewmempool.PackageAddTransaction(txns[i]);
+        m_package_txns.emplace(txns[i]->GetHash(), txns[i]);
+        new_txns.push_back(i);
+    }
+
+    if (package_feerate && !workspaces.empty()) {
+        CAmount package_fee{0};
+        size_t package_size{0};
+        for (const Workspace& ws : workspaces) {
+            package_fee += ws.m_modified_fees;
+            package_size += ws.m_entry->GetTxSize();
+        }
+        TxValidationState fee_state;
+        if (!CheckFeeRate(package_size, package_fee, fee_state)) {
+            package_state.Invalid(PackageValidationResult::PCKG_POLICY, fee_state.GetRejectReason(), fee_state.GetDebugMessage());
+            return result;
+        }
+    }
+
+    if (!CheckPackageLimits(workspaces, package_state)) return result;
+
+    // Script checks are only done once the whole package passed the cheaper checks.
+    std::vector<PrecomputedTransactionData> txdatas(workspaces.size());
+    for (size_t w = 0; w < workspaces.size(); ++w) {
+        ATMPArgs args = make_args(new_txns[w]);
+        if (!PolicyScriptChecks(args, workspaces[w], txdatas[w])) return fail_tx(new_txns[w]);
+    }
+
+    if (test_accept) {
+        // Passing PolicyScriptChecks implies passing ConsensusScriptChecks, and
+        // there are no further mempool checks.
+        for (const size_t i : new_txns) {
+            result.m_tx_results.emplace(txns[i]->GetWitnessHash(), MempoolAcceptResult{tx_states[i], tx_fees[i]});
+        }
+        return result;
+    }
+
+    // Either all transactions are added or none, so the consensus script checks
+    // of all of them are done before the first one is added. Inputs spending
+    // other package transactions are checked against those (see m_package_txns).
+    for (size_t w = 0; w < workspaces.size(); ++w) {
+        ATMPArgs args = make_args(new_txns[w]);
+        if (!ConsensusScriptChecks(args, workspaces[w], txdatas[w])) return fail_tx(new_txns[w]);
+    }
+
+    for (size_t w = 0; w < workspaces.size(); ++w) {
+        ATMPArgs args = make_args(new_txns[w]);
+        Workspace& ws = workspaces[w];
+        // In-mempool ancestors now include preceding package transactions. The
+        // limits were enforced by CheckPackageLimits() for the package as a whole,
+        // which bounds those of each transaction, so this can't fail.
+        ws.m_ancestors.clear();
+        std::string dummy_err_string;
+        const uint64_t no_limit{std::numeric_limits<uint64_t>::max()};
+        m_pool.CalculateMemPoolAncestors(*ws.m_entry, ws.m_ancestors, no_limit, no_limit, no_limit, no_limit, dummy_err_string);
+        if (!Finalize(args, ws)) {
+            // Take the transactions added so far out again. They were never
+            // announced, like those LimitMempool() evicts right after adding.
+            for (size_t added = 0; added < w; ++added) {
+                m_pool.removeRecursive(*workspaces[added].m_ptx, MemPoolRemovalReason::SIZELIMIT);
+            }
+            if (tx_states[new_txns[w]].IsValid()) {
+                tx_states[new_txns[w]].Invalid(TxValidationResult::TX_MEMPOOL_POLICY, "package-finalize-failed");
+            }
+            return fail_tx(new_txns[w]);
+        }
+    }
+
+    LimitMempool(/* bypass_limits */ false);
+    for (const size_t i : new_txns) {
+        if (m_pool.exists(txns[i]->GetHash())) {
+            GetMainSignals().TransactionAddedToMempool(txns[i], m_pool.GetAndIncrementSequence());
+        } else {
+            tx_states[i].Invalid(TxValidationResult::TX_MEMPOOL_POLICY, "mempool full");
+            package_state.Invalid(PackageValidationResult::PCKG_TX, "transaction failed");
+        }
+        result.m_tx_results.emplace(txns[i]->GetWitnessHash(), MempoolAcceptResult{tx_states[i],
+            tx_states[i].IsValid() ? Optional<CAmount>{tx_fees[i]} : nullopt});
+    }
+    return result;
+}
+
 } // anon namespace
 
 /** (try to) add transaction to memory pool with a specified acceptance time **/
@@ -1086,6 +1277,24 @@ bool AcceptToMemoryPool(CTxMemPool& pool, TxValidationState &state, const CTrans
     return AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, GetTime(), plTxnReplaced, bypass_limits, test_accept, fee_out);
 }
 
+PackageMempoolAcceptResult ProcessNewPackage(CTxMemPool& pool, const Package& package, bool test_accept)
+{
+    AssertLockHeld(cs_main);
+    const CChainParams& chainparams = Params();
+    std::vector<COutPoint> coins_to_uncache;
+    PackageMempoolAcceptResult result = MemPoolAccept(pool).AcceptMultipleTransactions(package, chainparams, GetTime(), coins_to_uncache, test_accept);
+    if (!result.m_state.IsValid()) {
+        // Remove coins that were not present in the coins cache before, see
+        // AcceptToMemoryPoolWithTime().
+        for (const COutPoint& outpoint : coins_to_uncache) {
+            ::ChainstateActive().CoinsTip().Uncache(outpoint);
+        }
+    }
+    BlockValidationState state_dummy;
+    ::ChainstateActive().FlushStateToDisk(chainparams, state_dummy, FlushStateMode::PERIODIC);
+    return result;
+}
+
 CTransactionRef GetTransaction(const CBlockIndex* const block_index, const CTxMemPool* const mempool, const uint256& hash, const Consensus::Params& consensusParams, uint256& hashBlock)
 {
     LOCK(cs_main);
@@ -1413,7 +1622,7 @@ int GetSpendHeight(const CCoinsViewCache& inputs)
 }
 
 
-static CuckooCache::cache<uint256, SignatureCacheHasher> g_scriptExecutionCache;
+static ShardedCuckooCache g_scriptExecutionCache;
 static CSHA256 g_scriptExecutionCacheHasher;
 
 void InitScriptExecutionCache() {
@@ -1467,7 +1676,6 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState &state, const C
     uint256 hashCacheEntry;
     CSHA256 hasher = g_scriptExecutionCacheHasher;
     hasher.Write(tx.GetWitnessHash().begin(), 32).Write((unsigned char*)&flags, sizeof(flags)).Finalize(hashCacheEntry.begin());
-    AssertLockHeld(cs_main); //TODO: Remove this requirement by making CuckooCache not require external locks
     if (g_scriptExecutionCache.contains(hashCacheEntry, !cacheFullScriptStore)) {
         return true;
     }
@@ -1486,6 +1694,52 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState &state, const C
     }
     assert(txdata.m_spent_outputs.size() == tx.vin.size());
 
+    const auto script_check_failed = [&](const CScriptCheck& check) {
+        if (flags & STANDARD_NOT_MANDATORY_VERIFY_FLAGS) {
+            // Check whether the failure was caused by a
+            // non-mandatory script verification check, such as
+            // non-standard DER encodings or non-null dummy
+            // arguments; if so, ensure we return NOT_STANDARD
+            // instead of CONSENSUS to avoid downstream users
+            // splitting the network between upgraded and
+            // non-upgraded nodes by banning CONSENSUS-failing
+            // data providers.
+            const unsigned int i = check.GetInputIndex();
+            CScriptCheck check2(txdata.m_spent_outputs[i], tx, i,
+                    flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheSigStore, &txdata);
+            if (check2())
+                return state.Invalid(TxValidationResult::TX_NOT_STANDARD, strprintf("non-mandatory-script-verify-flag (%s)", ScriptErrorString(check.GetScriptError())));
+        }
+        // MANDATORY flag failures correspond to
+        // TxValidationResult::TX_CONSENSUS. Because CONSENSUS
+        // failures are the most serious case of validation
+        // failures, we may need to consider using
+        // RECENT_CONSENSUS_CHANGE for any script failure that
+        // could be due to non-upgraded nodes which we may want to
+        // support, to avoid splitting the network (but this
+        // depends on the details of how net_processing handles
+        // such errors).
+        return state.Invalid(TxValidationResult::TX_CONSENSUS, strprintf("mandatory-script-verify-flag-failed (%s)", ScriptErrorString(check.GetScriptError())));
+    };
+
+    // Transactions with many inputs (e.g. during mempool acceptance) are checked
+    // on the script check threads, so one expensive transaction does not stall
+    // the calling thread for long. On failure, the first input found to fail
+    // is reported; with several invalid inputs it need not be the lowest one.
+    if (!pvChecks && g_parallel_script_checks && tx.vin.size() >= MIN_PARALLEL_TX_SCRIPT_CHECK_INPUTS) {
+        std::vector<CScriptCheck> checks;
+        checks.reserve(tx.vin.size());
+        for (unsigned int i = 0; i < tx.vin.size(); i++) {
+            checks.emplace_back(txdata.m_spent_outputs[i], tx, i, flags, cacheSigStore, &txdata);
+        }
+        CScriptCheck failed_check;
+        if (!RunScriptChecksInParallel(checks, &failed_check)) {
+            return script_check_failed(failed_check);
+        }
+        if (cacheFullScriptStore) g_scriptExecutionCache.insert(hashCacheEntry);
+        return true;
+    }
+
     for (unsigned int i = 0; i < tx.vin.size(); i++) {
 
         // We very carefully only pass in things to CScriptCheck which
@@ -1500,30 +1754,7 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState &state, const C
             pvChecks->push_back(CScriptCheck());
             check.swap(pvChecks->back());
         } else if (!check()) {
-            if (flags & STANDARD_NOT_MANDATORY_VERIFY_FLAGS) {
-                // Check whether the failure was caused by a
-                // non-mandatory script verification check, such as
-                // non-standard DER encodings or non-null dummy
-                // arguments; if so, ensure we return NOT_STANDARD
-                // instead of CONSENSUS to avoid downstream users
-                // splitting the network between upgraded and
-                // non-upgraded nodes by banning CONSENSUS-failing
-                // data providers.
-                CScriptCheck check2(txdata.m_spent_outputs[i], tx, i,
-                        flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheSigStore, &txdata);
-                if (check2())
-                    return state.Invalid(TxValidationResult::TX_NOT_STANDARD, strprintf("non-mandatory-script-verify-flag (%s)", ScriptErrorString(check.GetScriptError())));
-            }
-            // MANDATORY flag failures correspond to
-            // TxValidationResult::TX_CONSENSUS. Because CONSENSUS
-            // failures are the most serious case of validation
-            // failures, we may need to consider using
-            // RECENT_CONSENSUS_CHANGE for any script failure that
-            // could be due to non-upgraded nodes which we may want to
-            // support, to avoid splitting the network (but this
-            // depends on the details of how net_processing handles
-            // such errors).
-            return state.Invalid(TxValidationResult::TX_CONSENSUS, strprintf("mandatory-script-verify-flag-failed (%s)", ScriptErrorString(check.GetScriptError())));
+            return script_check_failed(check);
         }
     }
 
@@ -1763,6 +1994,13 @@ void ThreadScriptCheck(int worker_num) {
     scriptcheckqueue.Thread();
 }
 
+static bool RunScriptChecksInParallel(std::vector<CScriptCheck>& checks, CScriptCheck* failed_check)
+{
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    control.Add(checks);
+    return control.Wait(failed_check);
+}
+
 VersionBitsCache versionbitscache GUARDED_BY(cs_main);
 
 int32_t ComputeBlockVersion(const CBlockIndex* pindexPrev, const Consensus::Params& params)
@@ -4965,6 +5203,49 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
 
+/** Number of mempool.dat entries read and verified together on load. */
+static constexpr size_t MEMPOOL_LOAD_BATCH_SIZE{1000};
+
+/**
+ * Verify the scripts of a batch of mempool.dat entries on the script check
+ * threads, storing the valid signatures in the signature cache. Nothing read
+ * from the file is trusted: the mempool acceptance that follows still verifies
+ * every script, but finds the signatures cached. Expired transactions and those
+ * whose inputs are unknown are skipped, and failures are left for the
+ * acceptance to report.
+ */
+static void PreverifyMempoolScripts(CTxMemPool& pool, const std::vector<std::tuple<CTransactionRef, int64_t, int64_t>>& batch, int64_t min_time)
+{
+    // Stable addresses, as the checks point into these.
+    std::deque<PrecomputedTransactionData> txdata;
+    std::vector<CScriptCheck> checks;
+    {
+        LOCK2(cs_main, pool.cs);
+        CCoinsViewMemPool viewmempool(&::ChainstateActive().CoinsTip(), pool);
+        CCoinsViewCache view(&viewmempool);
+        for (const auto& entry : batch) {
+            if (std::get<1>(entry) <= min_time) continue;
+            const CTransaction& tx = *std::get<0>(entry);
+            std::vector<CTxOut> spent_outputs;
+            spent_outputs.reserve(tx.vin.size());
+            for (const CTxIn& txin : tx.vin) {
+                const Coin& coin = view.AccessCoin(txin.prevout);
+                if (coin.IsSpent()) break;
+                spent_outputs.push_back(coin.out);
+            }
+            if (spent_outputs.size() != tx.vin.size()) continue;
+            // Later transactions of the batch may spend this one.
+            AddCoins(view, tx, MEMPOOL_HEIGHT, /* check_for_overwrite */ true);
+            txdata.emplace_back();
+            txdata.back().Init(tx, std::move(spent_outputs));
+            for (unsigned int i = 0; i < tx.vin.size(); ++i) {
+                checks.emplace_back(txdata.back().m_spent_outputs[i], tx, i, STANDARD_SCRIPT_VERIFY_FLAGS, /* cacheIn */ true, &txdata.back());
+            }
+        }
+    }
+    RunScriptChecksInParallel(checks);
+}
+
 bool LoadMempool(CTxMemPool& pool)
 {
     const CChainParams& chainparams = Params();
@@ -4989,44 +5270,57 @@ bool LoadMempool(CTxMemPool& pool)
         if (version != MEMPOOL_DUMP_VERSION) {
             return false;
         }
+
+        // Verify the scripts of the transactions in batches on the script check
+        // threads before accepting them one by one.
+        LogPrintf("Verifying scripts of mempool file transactions in batches of %u\n", MEMPOOL_LOAD_BATCH_SIZE);
+
         uint64_t num;
         file >> num;
-        while (num--) {
-            CTransactionRef tx;
-            int64_t nTime;
-            int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
-            file >> nFeeDelta;
-
-            CAmount amountdelta = nFeeDelta;
-            if (amountdelta) {
-                pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+        while (num) {
+            std::vector<std::tuple<CTransactionRef, int64_t, int64_t>> batch;
+            batch.reserve(std::min<uint64_t>(num, MEMPOOL_LOAD_BATCH_SIZE));
+            for (; num && batch.size() < MEMPOOL_LOAD_BATCH_SIZE; --num) {
+                CTransactionRef tx;
+                int64_t nTime;
+                int64_t nFeeDelta;
+                file >> tx;
+                file >> nTime;
+                file >> nFeeDelta;
+                batch.emplace_back(std::move(tx), nTime, nFeeDelta);
             }
-            TxValidationState state;
-            if (nTime > nNow - nExpiryTimeout) {
-                LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, nTime,
-                                           nullptr /* plTxnReplaced */, false /* bypass_limits */,
-                                           false /* test_accept */);
-                if (state.IsValid()) {
-                    ++count;
-                } else {
-                    // mempool may contain the transaction already, e.g. from
-                    // wallet(s) having loaded it while we were processing
-                    // mempool transactions; consider these as valid, instead of
-                    // failed, but mark them as 'already there'
-                    if (pool.exists(tx->GetHash())) {
-                        ++already_there;
+            PreverifyMempoolScripts(pool, batch, nNow - nExpiryTimeout);
+
+            for (const auto& [tx, nTime, nFeeDelta] : batch) {
+                CAmount amountdelta = nFeeDelta;
+                if (amountdelta) {
+                    pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+                }
+                TxValidationState state;
+                if (nTime > nNow - nExpiryTimeout) {
+                    LOCK(cs_main);
+                    AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, nTime,
+                                               nullptr /* plTxnReplaced */, false /* bypass_limits */,
+                                               false /* test_accept */);
+                    if (state.IsValid()) {
+                        ++count;
                     } else {
-                        ++failed;
+                        // mempool may contain the transaction already, e.g. from
+                        // wallet(s) having loaded it while we were processing
+                        // mempool transactions; consider these as valid, instead of
+                        // failed, but mark them as 'already there'
+                        if (pool.exists(tx->GetHash())) {
+                            ++already_there;
+                        } else {
+                            ++failed;
+                        }
                     }
+                } else {
+                    ++expired;
                 }
-            } else {
-                ++expired;
+                if (ShutdownRequested())
+                    return false;
             }
-            if (ShutdownRequested())
-                return false;
         }
         std::map<uint256, CAmount> mapDeltas;
         file >> mapDeltas;
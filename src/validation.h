@@ -16,6 +16,7 @@
 #include <fs.h>
 #include <optional.h>
 #include <policy/feerate.h>
+#include <policy/packages.h>
 #include <protocol.h> // For CMessageHeader::MessageStartChars
 #include <script/script_error.h>
 #include <sync.h>
@@ -69,6 +70,8 @@ static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 15;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Minimum number of inputs for a loose transaction's scripts to be checked on the script-checking threads */
+static const unsigned int MIN_PARALLEL_TX_SCRIPT_CHECK_INPUTS = 8;
 static const int64_t DEFAULT_MAX_TIP_AGE = 24 * 60 * 60;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 static const bool DEFAULT_TXINDEX = false;
@@ -201,6 +204,40 @@ bool AcceptToMemoryPool(CTxMemPool& pool, TxValidationState &state, const CTrans
                         std::list<CTransactionRef>* plTxnReplaced,
                         bool bypass_limits, bool test_accept=false, CAmount* fee_out=nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/** Result of the mempool acceptance of one transaction of a package. */
+struct MempoolAcceptResult {
+    /** Invalid if the transaction was rejected, otherwise valid. */
+    TxValidationState m_state;
+    /** Base fee of the transaction, only set if it passed validation. */
+    Optional<CAmount> m_base_fees;
+};
+
+/** Result of the mempool acceptance of a package. */
+struct PackageMempoolAcceptResult {
+    /** Invalid if the package as a whole, or any transaction in it, was rejected. */
+    PackageValidationState m_state;
+    /** Results of the transactions that were evaluated, keyed by wtxid. Transactions
+     * which were not evaluated because validation stopped early have no entry. */
+    std::map<uint256, MempoolAcceptResult> m_tx_results;
+};
+
+/**
+ * Validate a package (a topologically sorted list of related transactions) for
+ * acceptance to the mempool, sharing one coins view across the package so that
+ * children can spend outputs of parents that are not in the mempool yet.
+ *
+ * If the package is one child with all of its parents, the package is held to the
+ * minimum feerate as a whole rather than per transaction, so a child can pay for
+ * parents that could not enter the mempool on their own. Transactions in a package
+ * may not replace mempool transactions. Those already in the mempool are skipped.
+ *
+ * Either all transactions are accepted or none of them are, except that some of them
+ * may be evicted again right away if the mempool is full.
+ *
+ * @param[in] test_accept   When true, run all checks but don't submit anything.
+ */
+PackageMempoolAcceptResult ProcessNewPackage(CTxMemPool& pool, const Package& package, bool test_accept) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 /** Get the BIP9 state for a given deployment at the current tip. */
 ThresholdState VersionBitsTipState(const Consensus::Params& params, Consensus::DeploymentPos pos);
 
@@ -238,10 +275,12 @@ bool TestLockPointValidity(const LockPoints* lp) EXCLUSIVE_LOCKS_REQUIRED(cs_mai
  * of the block needed for calculation or skips the calculation and uses the LockPoints
  * passed in for evaluation.
  * The LockPoints should not be considered valid if CheckSequenceLocks returns false.
+ * If coins_view is given, the coins spent by tx are looked up there instead of
+ * in the mempool and the chainstate (e.g. to see outputs of a package being validated).
  *
  * See consensus/consensus.h for flag definitions.
  */
-bool CheckSequenceLocks(const CTxMemPool& pool, const CTransaction& tx, int flags, LockPoints* lp = nullptr, bool useExistingLockPoints = false) EXCLUSIVE_LOCKS_REQUIRED(::cs_main, pool.cs);
+bool CheckSequenceLocks(const CTxMemPool& pool, const CTransaction& tx, int flags, LockPoints* lp = nullptr, bool useExistingLockPoints = false, const CCoinsView* coins_view = nullptr) EXCLUSIVE_LOCKS_REQUIRED(::cs_main, pool.cs);
 
 /**
  * Closure representing one script verification
@@ -276,6 +315,7 @@ public:
     }
 
     ScriptError GetScriptError() const { return error; }
+    unsigned int GetInputIndex() const { return nIn; }
 };
 
 /** Initializes the script-execution cache */
@@ -7,6 +7,7 @@
 
 #include <util/memory.h>
 
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -14,12 +15,14 @@ class CBlockIndex;
 class CTransaction;
 class CZMQAbstractNotifier;
 
-using CZMQNotifierFactory = std::unique_ptr<CZMQAbstractNotifier> (*)();
+using CZMQNotifierFactory = std::function<std::unique_ptr<CZMQAbstractNotifier>()>;
 
 class CZMQAbstractNotifier
 {
 public:
     static const int DEFAULT_ZMQ_SNDHWM {1000};
+    //! Fees (in satoshis) newly accepted to the mempool that trigger a template notification
+    static const int64_t DEFAULT_ZMQ_TEMPLATE_FEE_DELTA {10000};
 
     CZMQAbstractNotifier() : psocket(nullptr), outbound_message_high_water_mark(DEFAULT_ZMQ_SNDHWM) { }
     virtual ~CZMQAbstractNotifier();
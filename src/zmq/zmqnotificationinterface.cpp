@@ -9,6 +9,7 @@
 #include <zmq.h>
 
 #include <validation.h>
+#include <util/moneystr.h>
 #include <util/system.h>
 
 CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(nullptr)
@@ -29,14 +30,23 @@ std::list<const CZMQAbstractNotifier*> CZMQNotificationInterface::GetActiveNotif
     return result;
 }
 
-CZMQNotificationInterface* CZMQNotificationInterface::Create()
+CZMQNotificationInterface* CZMQNotificationInterface::Create(const CTxMemPool* mempool)
 {
+    CAmount template_fee_delta{CZMQAbstractNotifier::DEFAULT_ZMQ_TEMPLATE_FEE_DELTA};
+    if (gArgs.IsArgSet("-zmqpubtemplatefeedelta") && !ParseMoney(gArgs.GetArg("-zmqpubtemplatefeedelta", ""), template_fee_delta)) {
+        // Invalid values are already rejected in AppInitParameterInteraction
+        template_fee_delta = CZMQAbstractNotifier::DEFAULT_ZMQ_TEMPLATE_FEE_DELTA;
+    }
+
     std::map<std::string, CZMQNotifierFactory> factories;
     factories["pubhashblock"] = CZMQAbstractNotifier::Create<CZMQPublishHashBlockNotifier>;
     factories["pubhashtx"] = CZMQAbstractNotifier::Create<CZMQPublishHashTransactionNotifier>;
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
     factories["pubsequence"] = CZMQAbstractNotifier::Create<CZMQPublishSequenceNotifier>;
+    factories["pubtemplate"] = [mempool, template_fee_delta] {
+        return std::unique_ptr<CZMQAbstractNotifier>(MakeUnique<CZMQPublishTemplateNotifier>(mempool, template_fee_delta));
+    };
 
     std::list<std::unique_ptr<CZMQAbstractNotifier>> notifiers;
     for (const auto& entry : factories)
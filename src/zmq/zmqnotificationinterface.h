@@ -10,6 +10,7 @@
 #include <memory>
 
 class CBlockIndex;
+class CTxMemPool;
 class CZMQAbstractNotifier;
 
 class CZMQNotificationInterface final : public CValidationInterface
@@ -19,7 +20,7 @@ public:
 
     std::list<const CZMQAbstractNotifier*> GetActiveNotifiers() const;
 
-    static CZMQNotificationInterface* Create();
+    static CZMQNotificationInterface* Create(const CTxMemPool* mempool);
 
 protected:
     bool Initialize();
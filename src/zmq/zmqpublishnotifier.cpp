@@ -8,6 +8,7 @@
 #include <chainparams.h>
 #include <rpc/server.h>
 #include <streams.h>
+#include <txmempool.h>
 #include <util/system.h>
 #include <validation.h>
 #include <zmq/zmqutil.h>
@@ -27,6 +28,7 @@ static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
 static const char *MSG_SEQUENCE  = "sequence";
+static const char *MSG_TEMPLATE  = "template";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -274,3 +276,46 @@ bool CZMQPublishSequenceNotifier::NotifyTransactionRemoval(const CTransaction &t
     WriteLE64(data+sizeof(uint256)+1, mempool_sequence);
     return SendZmqMessage(MSG_SEQUENCE, data, sizeof(data));
 }
+
+bool CZMQPublishTemplateNotifier::SendTemplateMessage(CAmount fees, uint64_t mempool_sequence)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish template on tip %s (fees added %d, mempool sequence %d) to %s\n", m_tip_hash.GetHex(), fees, mempool_sequence, this->address);
+    unsigned char data[sizeof(uint256)+sizeof(fees)+sizeof(mempool_sequence)];
+    for (unsigned int i = 0; i < sizeof(uint256); i++)
+        data[sizeof(uint256) - 1 - i] = m_tip_hash.begin()[i];
+    WriteLE64(data+sizeof(uint256), fees);
+    WriteLE64(data+sizeof(uint256)+sizeof(fees), mempool_sequence);
+    return SendZmqMessage(MSG_TEMPLATE, data, sizeof(data));
+}
+
+bool CZMQPublishTemplateNotifier::NotifyBlock(const CBlockIndex *pindex)
+{
+    // A new tip invalidates any template, regardless of the mempool contents
+    m_tip_hash = pindex->GetBlockHash();
+    m_pending_fees = 0;
+    const uint64_t mempool_sequence{m_mempool ? WITH_LOCK(m_mempool->cs, return m_mempool->GetSequence()) : 0};
+    return SendTemplateMessage(0, mempool_sequence);
+}
+
+bool CZMQPublishTemplateNotifier::NotifyTransactionAcceptance(const CTransaction &transaction, uint64_t mempool_sequence)
+{
+    if (!m_mempool) return true;
+    // The transaction may already have been removed again by the time this
+    // notification is processed, in which case it doesn't affect the template.
+    const TxMempoolInfo info{m_mempool->info(transaction.GetHash())};
+    if (!info.tx) return true;
+    m_pending_fees += info.fee + info.nFeeDelta;
+    if (m_pending_fees < m_fee_delta) return true;
+
+    if (m_tip_hash.IsNull()) {
+        // No new block was connected since startup
+        LOCK(cs_main);
+        if (!::ChainActive().Tip()) return true;
+        m_tip_hash = ::ChainActive().Tip()->GetBlockHash();
+    }
+    const CAmount fees{m_pending_fees};
+    m_pending_fees = 0;
+    // Report the sequence number the mempool had right after this transaction
+    // was added, as getrawmempool would.
+    return SendTemplateMessage(fees, mempool_sequence + 1);
+}
@@ -7,7 +7,11 @@
 
 #include <zmq/zmqabstractnotifier.h>
 
+#include <amount.h>
+#include <uint256.h>
+
 class CBlockIndex;
+class CTxMemPool;
 
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 {
@@ -61,4 +65,26 @@ public:
     bool NotifyTransactionRemoval(const CTransaction &transaction, uint64_t mempool_sequence) override;
 };
 
+/**
+ * Tells miners when a new block template is worth fetching: on every new tip,
+ * and whenever the (modified) fees of transactions accepted to the mempool
+ * since the last notification reach a threshold.
+ */
+class CZMQPublishTemplateNotifier : public CZMQAbstractPublishNotifier
+{
+private:
+    const CTxMemPool* const m_mempool;
+    const CAmount m_fee_delta;
+    uint256 m_tip_hash;
+    CAmount m_pending_fees{0};
+
+    bool SendTemplateMessage(CAmount fees, uint64_t mempool_sequence);
+
+public:
+    CZMQPublishTemplateNotifier(const CTxMemPool* mempool, CAmount fee_delta) : m_mempool(mempool), m_fee_delta(fee_delta) {}
+
+    bool NotifyBlock(const CBlockIndex *pindex) override;
+    bool NotifyTransactionAcceptance(const CTransaction &transaction, uint64_t mempool_sequence) override;
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test estimatesmartfee with -mempoolfeeestimates."""
+
+from decimal import Decimal
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+from test_framework.wallet import MiniWallet
+
+
+class MempoolFeeEstimationTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 2
+        self.setup_clean_chain = True
+        # On node 0, a simulated block has room for two of MiniWallet's 96 vB
+        # transactions next to the coinbase. Node 1 simulates full size blocks.
+        self.extra_args = [
+            ["-mempoolfeeestimates", "-blockmaxweight=5000"],
+            ["-mempoolfeeestimates"],
+        ]
+
+    def run_test(self):
+        node = self.nodes[0]
+        wallet = MiniWallet(node)
+        wallet.generate(10)
+        node.generate(100)
+        self.sync_all()
+
+        self.log.info("Fill the mempool with three full simulated blocks and part of a fourth")
+        for fee_rate in ["0.0006", "0.0005", "0.0005", "0.0005", "0.0003", "0.0003", "0.0001"]:
+            wallet.send_self_transfer(fee_rate=Decimal(fee_rate), from_node=node)
+        self.sync_mempools()
+
+        self.log.info("Test that the estimates are the lowest feerates of the simulated blocks")
+        estimate = node.estimatesmartfee(1)
+        assert_equal(estimate['feerate'], Decimal("0.0005"))
+        assert_equal(estimate['blocks'], 1)
+        estimate = node.estimatesmartfee(3)
+        assert_equal(estimate['feerate'], Decimal("0.0003"))
+        assert_equal(estimate['blocks'], 3)
+        # The partially filled fourth block doesn't constrain the feerate, and
+        # there is no data from confirmations yet
+        assert 'feerate' not in node.estimatesmartfee(4)
+
+        self.log.info("Test that the target the estimate was found at is returned")
+        # The second simulated block needs the same feerate as the first
+        estimate = node.estimatesmartfee(2)
+        assert_equal(estimate['feerate'], Decimal("0.0005"))
+        assert_equal(estimate['blocks'], 1)
+
+        self.log.info("Test that the blocks are simulated with -blockmaxweight")
+        # All transactions fit in a single, partially filled, block
+        assert 'feerate' not in self.nodes[1].estimatesmartfee(1)
+
+        self.log.info("Test that the estimates are updated when a block is connected")
+        node.generate(1)
+        self.sync_all()
+        estimate = node.estimatesmartfee(2)
+        assert_equal(estimate['feerate'], Decimal("0.0003"))
+        assert_equal(estimate['blocks'], 2)
+
+
+if __name__ == '__main__':
+    MempoolFeeEstimationTest().main()
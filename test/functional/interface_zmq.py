@@ -75,6 +75,7 @@ class ZMQTest (BitcoinTestFramework):
             self.test_mempool_sync()
             self.test_reorg()
             self.test_multiple_interfaces()
+            self.test_template()
         finally:
             # Destroy the ZMQ context.
             self.log.debug("Destroying ZMQ context")
@@ -529,5 +530,42 @@ class ZMQTest (BitcoinTestFramework):
         assert_equal(self.nodes[0].getbestblockhash(), subscribers[0]['hashblock'].receive().hex())
         assert_equal(self.nodes[0].getbestblockhash(), subscribers[1]['hashblock'].receive().hex())
 
+    def test_template(self):
+        if not self.is_wallet_compiled():
+            self.log.info("Skipping template test, since wallet not compiled")
+            return
+
+        self.log.info("Testing block template update hints")
+        address = 'tcp://127.0.0.1:28336'
+        socket = self.ctx.socket(zmq.SUB)
+        socket.set(zmq.RCVTIMEO, 60000)
+        template = ZMQSubscriber(socket, b"template")
+
+        # Hint at a new template once at least 5000 satoshis of fees were added
+        self.restart_node(0, ['-zmqpubtemplate=%s' % address, '-zmqpubtemplatefeedelta=0.00005'])
+        socket.connect(address)
+        # Relax so that the subscriber is ready before publishing zmq messages
+        sleep(0.2)
+
+        def receive_template():
+            body = template.receive()
+            assert_equal(len(body), 32 + 8 + 8)
+            fees, mempool_sequence = struct.unpack('<qQ', body[32:])
+            return body[:32].hex(), fees, mempool_sequence
+
+        # Every new tip is announced
+        tip = self.nodes[0].generatetoaddress(1, ADDRESS_BCRT1_UNSPENDABLE)[0]
+        mempool_sequence = self.nodes[0].getrawmempool(mempool_sequence=True)['mempool_sequence']
+        assert_equal(receive_template(), (tip, 0, mempool_sequence))
+
+        # Fees of transactions below the threshold are accumulated until it is reached
+        fees = 0
+        for _ in range(2):
+            txid = self.nodes[0].sendtoaddress(self.nodes[0].getnewaddress(), 1.0)
+            fees += int(self.nodes[0].getmempoolentry(txid)['fees']['base'] * 100000000)
+        assert fees >= 5000
+        mempool_sequence = self.nodes[0].getrawmempool(mempool_sequence=True)['mempool_sequence']
+        assert_equal(receive_template(), (tip, fees, mempool_sequence))
+
 if __name__ == '__main__':
     ZMQTest().main()
@@ -60,6 +60,7 @@ class NetTest(BitcoinTestFramework):
 
         self.test_connection_count()
         self.test_getpeerinfo()
+        self.test_getmessagetimings()
         self.test_getnettotals()
         self.test_getnetworkinfo()
         self.test_getaddednodeinfo()
@@ -101,6 +102,20 @@ class NetTest(BitcoinTestFramework):
         assert_equal(peer_info[1][0]['connection_type'], 'manual')
         assert_equal(peer_info[1][1]['connection_type'], 'inbound')
 
+    def test_getmessagetimings(self):
+        self.log.info("Test getmessagetimings")
+        timings = self.nodes[0].getmessagetimings()
+        assert_equal(sorted(t['id'] for t in timings), sorted(p['id'] for p in self.nodes[0].getpeerinfo()))
+        for peer in timings:
+            assert_greater_than(peer['sendmessages']['count'], 0)
+            # Both peers went through the version handshake
+            for msg in ['version', 'verack']:
+                timing = peer['processmessage'][msg]
+                assert_equal(timing['count'], 1)
+                assert_equal(sum(timing['histogram']), timing['count'])
+                assert timing['max_us'] <= timing['total_us']
+            assert all(t['count'] > 0 for t in peer['processmessage'].values())
+
     def test_getnettotals(self):
         self.log.info("Test getnettotals")
         # Test getnettotals and getpeerinfo by doing a ping. The bytes
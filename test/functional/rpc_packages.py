@@ -0,0 +1,241 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""RPCs that handle raw transaction packages."""
+
+from decimal import Decimal
+
+from test_framework.address import ADDRESS_BCRT1_P2WSH_OP_TRUE
+from test_framework.messages import (
+    COIN,
+    COutPoint,
+    CTransaction,
+    CTxIn,
+    CTxInWitness,
+    CTxOut,
+)
+from test_framework.script import (
+    CScript,
+    OP_TRUE,
+)
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    hex_str_to_bytes,
+)
+
+
+class RPCPackagesTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+
+    def create_tx(self, prevout, value_in, fee, n_outputs=1):
+        """Create a transaction spending prevout (paid to the OP_TRUE P2WSH address), paying
+        value_in - fee split over n_outputs outputs back to the same address."""
+        tx = CTransaction()
+        tx.vin = [CTxIn(prevout)]
+        out_value = int((value_in - fee) * COIN) // n_outputs
+        tx.vout = [CTxOut(out_value, self.script_pubkey) for _ in range(n_outputs)]
+        tx.wit.vtxinwit = [CTxInWitness()]
+        tx.wit.vtxinwit[0].scriptWitness.stack = [CScript([OP_TRUE])]
+        tx.rehash()
+        return tx, Decimal(out_value) / COIN
+
+    def run_test(self):
+        node = self.nodes[0]
+        self.script_pubkey = hex_str_to_bytes(node.validateaddress(ADDRESS_BCRT1_P2WSH_OP_TRUE)['scriptPubKey'])
+        blocks = node.generatetoaddress(120, ADDRESS_BCRT1_P2WSH_OP_TRUE)
+        self.coins = []
+        for blockhash in blocks[:20]:
+            coinbase = node.getblock(blockhash=blockhash, verbosity=2)['tx'][0]
+            self.coins.append((COutPoint(int(coinbase['txid'], 16), 0), coinbase['vout'][0]['value']))
+
+        self.test_chain()
+        self.test_invalid_packages()
+        self.test_cpfp()
+        self.test_submitpackage()
+
+    def test_chain(self):
+        node = self.nodes[0]
+        self.log.info("Test a chain of transactions")
+        prevout, value = self.coins.pop()
+        chain = []
+        for _ in range(10):
+            tx, value = self.create_tx(prevout, value, Decimal("0.0001"))
+            chain.append(tx)
+            prevout = COutPoint(tx.sha256, 0)
+        chain_hex = [tx.serialize().hex() for tx in chain]
+
+        # Only the first transaction is valid on its own
+        assert_equal(node.testmempoolaccept([chain_hex[0]])[0]['allowed'], True)
+        assert_equal(node.testmempoolaccept([chain_hex[1]])[0]['reject-reason'], 'missing-inputs')
+
+        testres = node.testmempoolaccept(chain_hex)
+        assert_equal(len(testres), len(chain))
+        for tx, res in zip(chain, testres):
+            assert_equal(res['txid'], tx.hash)
+            assert_equal(res['allowed'], True)
+            assert_equal(res['vsize'], tx.get_vsize())
+            assert_equal(res['fees']['base'], Decimal("0.0001"))
+        assert_equal(node.getrawmempool(), [])
+
+        self.log.info("Test maxfeerate is applied to each transaction of a package")
+        testres = node.testmempoolaccept(chain_hex, Decimal("0.00001"))
+        assert_equal(testres[0]['allowed'], False)
+        assert_equal(testres[0]['reject-reason'], 'max-fee-exceeded')
+        # The rest of the package is not reported once a parent would not be submitted
+        assert 'allowed' not in testres[1]
+
+    def test_invalid_packages(self):
+        node = self.nodes[0]
+        prevout, value = self.coins.pop()
+        parent, parent_value = self.create_tx(prevout, value, Decimal("0.0001"), n_outputs=2)
+        child1, _ = self.create_tx(COutPoint(parent.sha256, 0), parent_value, Decimal("0.0001"))
+        child2, _ = self.create_tx(COutPoint(parent.sha256, 0), parent_value, Decimal("0.0002"))
+
+        self.log.info("Test that a package must be sorted")
+        testres = node.testmempoolaccept([child1.serialize().hex(), parent.serialize().hex()])
+        assert_equal(testres, [
+            {'txid': child1.hash, 'package-error': 'package-not-sorted'},
+            {'txid': parent.hash, 'package-error': 'package-not-sorted'},
+        ])
+
+        self.log.info("Test that transactions in a package can't conflict")
+        testres = node.testmempoolaccept([parent.serialize().hex(), child1.serialize().hex(), child2.serialize().hex()])
+        assert_equal(testres, [
+            {'txid': parent.hash, 'package-error': 'conflict-in-package'},
+            {'txid': child1.hash, 'package-error': 'conflict-in-package'},
+            {'txid': child2.hash, 'package-error': 'conflict-in-package'},
+        ])
+
+        self.log.info("Test that duplicates are rejected")
+        testres = node.testmempoolaccept([parent.serialize().hex(), parent.serialize().hex()])
+        assert_equal(testres[0]['package-error'], 'package-contains-duplicates')
+
+        self.log.info("Test that an invalid transaction fails the package")
+        bad_child = CTransaction(child1)
+        bad_child.wit.vtxinwit = []
+        bad_child.rehash()
+        testres = node.testmempoolaccept([parent.serialize().hex(), bad_child.serialize().hex()])
+        assert_equal(testres[0]['txid'], parent.hash)
+        assert 'allowed' not in testres[0]
+        assert_equal(testres[1]['allowed'], False)
+        assert 'package-error' not in testres[1]
+
+        self.log.info("Test that package transactions may not replace mempool transactions")
+        node.sendrawtransaction(parent.serialize().hex())
+        child1_hex = child1.serialize().hex()
+        node.sendrawtransaction(child1_hex)
+        other_prevout, other_value = self.coins.pop()
+        other_parent, other_value = self.create_tx(other_prevout, other_value, Decimal("0.0001"))
+        replacement = CTransaction()
+        replacement.vin = [CTxIn(COutPoint(parent.sha256, 0), nSequence=0), CTxIn(COutPoint(other_parent.sha256, 0))]
+        replacement.vout = [CTxOut(int((parent_value + other_value - Decimal("0.01")) * COIN), self.script_pubkey)]
+        replacement.wit.vtxinwit = [CTxInWitness(), CTxInWitness()]
+        replacement.wit.vtxinwit[0].scriptWitness.stack = [CScript([OP_TRUE])]
+        replacement.wit.vtxinwit[1].scriptWitness.stack = [CScript([OP_TRUE])]
+        replacement.rehash()
+        testres = node.testmempoolaccept([other_parent.serialize().hex(), replacement.serialize().hex()])
+        # child1 signals replaceability, but package transactions can't replace anything
+        assert_equal(testres[1]['reject-reason'], 'bip125-replacement-disallowed')
+        node.generate(1)
+
+    def test_cpfp(self):
+        node = self.nodes[0]
+        self.log.info("Test that a child can pay for its parents")
+        prevout_a, value_a = self.coins.pop()
+        prevout_b, value_b = self.coins.pop()
+        parent_a, parent_a_value = self.create_tx(prevout_a, value_a, 0)
+        parent_b, parent_b_value = self.create_tx(prevout_b, value_b, 0)
+        # Neither parent pays any fee, so each is rejected on its own
+        for parent in [parent_a, parent_b]:
+            testres = node.testmempoolaccept([parent.serialize().hex()])
+            assert_equal(testres[0]['reject-reason'], 'min relay fee not met')
+
+        child = CTransaction()
+        child.vin = [CTxIn(COutPoint(parent_a.sha256, 0)), CTxIn(COutPoint(parent_b.sha256, 0))]
+        child.vout = [CTxOut(int((parent_a_value + parent_b_value - Decimal("0.001")) * COIN), self.script_pubkey)]
+        child.wit.vtxinwit = [CTxInWitness(), CTxInWitness()]
+        child.wit.vtxinwit[0].scriptWitness.stack = [CScript([OP_TRUE])]
+        child.wit.vtxinwit[1].scriptWitness.stack = [CScript([OP_TRUE])]
+        child.rehash()
+        package_hex = [parent_a.serialize().hex(), parent_b.serialize().hex(), child.serialize().hex()]
+        testres = node.testmempoolaccept(package_hex)
+        assert_equal([res['allowed'] for res in testres], [True, True, True])
+        assert_equal(testres[0]['fees']['base'], 0)
+        assert_equal(testres[2]['fees']['base'], Decimal("0.001"))
+
+        self.log.info("Test that unrelated transactions can't pay for each other")
+        prevout_c, value_c = self.coins.pop()
+        unrelated, _ = self.create_tx(prevout_c, value_c, Decimal("0.01"))
+        testres = node.testmempoolaccept([parent_a.serialize().hex(), unrelated.serialize().hex()])
+        assert_equal(testres[0]['reject-reason'], 'min relay fee not met')
+
+        self.log.info("Test that a package failing the minimum feerate as a whole is rejected")
+        cheap_child, _ = self.create_tx(COutPoint(parent_a.sha256, 0), parent_a_value, Decimal("0.00000010"))
+        testres = node.testmempoolaccept([parent_a.serialize().hex(), cheap_child.serialize().hex()])
+        assert_equal(testres[0]['package-error'], 'min relay fee not met')
+
+        self.cpfp_package = package_hex
+
+    def test_submitpackage(self):
+        node = self.nodes[0]
+        self.log.info("Test submitpackage")
+        assert_equal(node.getrawmempool(), [])
+        res = node.submitpackage(self.cpfp_package)
+        assert 'package-error' not in res
+        assert_equal([tx['allowed'] for tx in res['tx-results']], [True, True, True])
+        assert_equal(sorted(node.getrawmempool()), sorted(tx['txid'] for tx in res['tx-results']))
+        parent_entry = node.getmempoolentry(res['tx-results'][0]['txid'])
+        assert_equal(parent_entry['descendantcount'], 2)
+
+        self.log.info("Test that a package is either accepted as a whole or not at all")
+        prevout, value = self.coins.pop()
+        parent, parent_value = self.create_tx(prevout, value, Decimal("0.0001"))
+        bad_child, _ = self.create_tx(COutPoint(parent.sha256, 0), parent_value, Decimal("0.0001"))
+        bad_child.wit.vtxinwit = []
+        bad_child.rehash()
+        res = node.submitpackage([parent.serialize().hex(), bad_child.serialize().hex()])
+        assert_equal(res['tx-results'][1]['allowed'], False)
+        assert parent.hash not in node.getrawmempool()
+
+        self.log.info("Test that no transaction is added when the last one of a package fails")
+        prevout, value = self.coins.pop()
+        chain = []
+        for _ in range(5):
+            tx, value = self.create_tx(prevout, value, Decimal("0.0001"))
+            chain.append(tx)
+            prevout = COutPoint(tx.sha256, 0)
+        chain[-1].wit.vtxinwit = []
+        chain[-1].rehash()
+        res = node.submitpackage([tx.serialize().hex() for tx in chain])
+        assert_equal(res['tx-results'][-1]['allowed'], False)
+        mempool = node.getrawmempool()
+        assert not any(tx.hash in mempool for tx in chain)
+
+        self.log.info("Test that package transactions already in the mempool are skipped")
+        prevout, value = self.coins.pop()
+        parent, parent_value = self.create_tx(prevout, value, Decimal("0.0001"))
+        child, _ = self.create_tx(COutPoint(parent.sha256, 0), parent_value, Decimal("0.0001"))
+        node.sendrawtransaction(parent.serialize().hex())
+        package_hex = [parent.serialize().hex(), child.serialize().hex()]
+        testres = node.testmempoolaccept(package_hex)
+        assert_equal([res['allowed'] for res in testres], [True, True])
+        assert_equal(testres[0]['fees']['base'], Decimal("0.0001"))
+        res = node.submitpackage(package_hex)
+        assert 'package-error' not in res
+        assert_equal([tx['allowed'] for tx in res['tx-results']], [True, True])
+        assert_equal(node.getmempoolentry(child.hash)['ancestorcount'], 2)
+        # Nothing is left to add when the whole package is in the mempool
+        res = node.submitpackage(package_hex)
+        assert_equal([tx['allowed'] for tx in res['tx-results']], [True, True])
+
+        # Mine the package
+        node.generate(1)
+        assert_equal(node.getrawmempool(), [])
+
+
+if __name__ == '__main__':
+    RPCPackagesTest().main()
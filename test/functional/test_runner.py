@@ -160,6 +160,7 @@ BASE_SCRIPTS = [
     'wallet_reorgsrestore.py',
     'interface_http.py',
     'interface_rpc.py',
+    'rpc_packages.py',
     'rpc_psbt.py',
     'rpc_psbt.py --descriptors',
     'rpc_users.py',
@@ -222,6 +223,7 @@ BASE_SCRIPTS = [
     'feature_nulldummy.py --descriptors',
     'mempool_accept.py',
     'mempool_expiry.py',
+    'feature_mempool_fee_estimation.py',
     'wallet_import_rescan.py --legacy-wallet',
     'wallet_import_with_label.py --legacy-wallet',
     'wallet_importdescriptors.py --descriptors',